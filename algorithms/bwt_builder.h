@@ -0,0 +1,130 @@
+/*
+ *  This file is part of BWTIL.
+ *  Copyright (c) by
+ *  Nicola Prezza <nicolapr@gmail.com>
+ *
+ *   BWTIL is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+
+ *   BWTIL is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details (<http://www.gnu.org/licenses/>).
+ */
+
+/*
+ * bwt_builder.h
+ *
+ *      Description: chooses the BWT construction engine. sa_bwt (parallel suffix sorting, fast, about 13n-25n bytes of RAM)
+ *      is used if its memory requirement fits in the RAM budget, cw_bwt (compressed working space, single thread) otherwise.
+ *
+ *      Default RAM budget: half of the physical memory.
+ */
+
+#ifndef BWTBUILDER_H_
+#define BWTBUILDER_H_
+
+#include "cw_bwt.h"
+#include "sa_bwt.h"
+#include <unistd.h>
+
+namespace bwtil {
+
+class bwt_builder {
+
+public:
+
+	enum engine {automatic, compressed, suffix_sorting};
+
+	/*
+	 * engine to be used for a text of length n with a RAM budget of ram_budget bytes (0 = half of the physical memory)
+	 */
+	static engine chooseEngine(ulint n, ulint ram_budget=0){
+
+		if(ram_budget==0)
+			ram_budget = physicalMemory()/2;
+
+		return sa_bwt::memoryRequirement(n) <= ram_budget ? suffix_sorting : compressed;
+
+	}
+
+	/*
+	 * returns the BWT (with 0x0 terminator) of the text (input_type = cw_bwt::text), of the file (input_type = cw_bwt::path) or
+	 * of the sequences of a FASTA/FASTQ/2-bit file (input_type = cw_bwt::sequence_path)
+	 */
+	static string toString(string &input_string, cw_bwt::cw_bwt_input_type input_type, bool verbose=false, engine e=automatic, ulint ram_budget=0){
+
+		if(chooseEngine(input_string, input_type, e, ram_budget, verbose)==suffix_sorting)
+			return sa_bwt(input_string,input_type,verbose).toString();
+
+		return cw_bwt(input_string,input_type,verbose).toString();
+
+	}
+
+	/*
+	 * stores to file the BWT (with 0x0 terminator) of the text (input_type = cw_bwt::text), of the file (input_type = cw_bwt::path)
+	 * or of the sequences of a FASTA/FASTQ/2-bit file (input_type = cw_bwt::sequence_path)
+	 */
+	static void toFile(string &input_string, cw_bwt::cw_bwt_input_type input_type, string out_path, bool verbose=false, engine e=automatic, ulint ram_budget=0){
+
+		if(chooseEngine(input_string, input_type, e, ram_budget, verbose)==suffix_sorting)
+			sa_bwt(input_string,input_type,verbose).toFile(out_path);
+		else
+			cw_bwt(input_string,input_type,verbose).toFile(out_path);
+
+	}
+
+	//bytes of physical memory
+	static ulint physicalMemory(){
+
+		long pages = sysconf(_SC_PHYS_PAGES);
+		long page_size = sysconf(_SC_PAGE_SIZE);
+
+		if(pages<=0 or page_size<=0)
+			return 0;
+
+		return (ulint)pages*(ulint)page_size;
+
+	}
+
+private:
+
+	static engine chooseEngine(string &input_string, cw_bwt::cw_bwt_input_type input_type, engine e, ulint ram_budget, bool verbose){
+
+		if(e!=automatic)
+			return e;
+
+		ulint n;
+
+		if(input_type==cw_bwt::path){
+
+			FileReader fr(input_string);
+			n = fr.size();
+			fr.close();
+
+		}else if(input_type==cw_bwt::sequence_path){
+
+			SequenceFileReader fr(input_string);
+			n = fr.size();
+			fr.close();
+
+		}else{
+
+			n = input_string.length();
+
+		}
+
+		e = chooseEngine(n,ram_budget);
+
+		if(verbose) cout << "BWT construction engine: " << (e==suffix_sorting ? "suffix sorting (sa_bwt)" : "compressed (cw_bwt)") << endl;
+
+		return e;
+
+	}
+
+};
+
+} /* namespace bwtil */
+#endif /* BWTBUILDER_H_ */
@@ -33,6 +33,7 @@
 #include "../data_structures/DynamicString.h"
 #include "../data_structures/BackwardFileIterator.h"
 #include "../data_structures/BackwardStringIterator.h"
+#include "../data_structures/BackwardSequenceIterator.h"
 #include "../data_structures/ContextAutomata.h"
 
 namespace bwtil {
@@ -41,7 +42,8 @@ class cw_bwt {
 
 public:
 
-	enum cw_bwt_input_type {path,text};
+	//sequence_path: path of a FASTA, FASTQ (possibly gzipped) or 2-bit file, whose sequences are the text (see SequenceFile.h)
+	enum cw_bwt_input_type {path,text,sequence_path};
 
 	class cw_bwt_iterator{
 
@@ -113,6 +115,8 @@ public:
 
 		if(input_type==path)
 			bwIt = new BackwardFileIterator(input_string);
+		else if(input_type==sequence_path)
+			bwIt = new BackwardSequenceIterator(input_string,verbose);
 		else
 			bwIt = new BackwardStringIterator(input_string);
 
@@ -142,6 +146,8 @@ public:
 
 		if(input_type==path)
 			bwIt = new BackwardFileIterator(input_string);
+		else if(input_type==sequence_path)
+			bwIt = new BackwardSequenceIterator(input_string,verbose);
 		else
 			bwIt = new BackwardStringIterator(input_string);
 
@@ -0,0 +1,424 @@
+/*
+ *  This file is part of BWTIL.
+ *  Copyright (c) by
+ *  Nicola Prezza <nicolapr@gmail.com>
+ *
+ *   BWTIL is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+
+ *   BWTIL is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details (<http://www.gnu.org/licenses/>).
+ */
+
+/*
+ * sa_bwt.h
+ *
+ *      Description: builds the BWT in RAM by multi-threaded suffix sorting. Alternative to cw_bwt when the machine has enough
+ *      RAM: about 13n bytes for n < 2^32 and 25n bytes otherwise (text, suffix array, ranks, temporary keys and BWT).
+ *
+ *      Suffixes are first sorted by their first k characters, packed in a 64-bit key (k = 64/log(sigma+1)). Then, prefix doubling
+ *      (Larsson-Sadakane): at each round only the groups of suffixes with equal h-prefix are refined, sorting them by the rank of
+ *      the suffix h positions ahead. Groups are processed in parallel (large groups with a parallel merge sort).
+ *
+ *      Output is the same of cw_bwt: the BWT of the text with a 0x0 terminator (n+1 characters).
+ *
+ *      WARNING: text must not contain a 0x0 byte, since this byte is appended as text terminator and included in the BWT
+ */
+
+#ifndef SABWT_H_
+#define SABWT_H_
+
+#include "../common/common.h"
+#include "../data_structures/FileReader.h"
+#include "../data_structures/SequenceFileReader.h"
+#include "cw_bwt.h"
+#include <thread>
+#include <atomic>
+#include <functional>
+
+namespace bwtil {
+
+class sa_bwt {
+
+public:
+
+	sa_bwt(){};
+
+	/*
+	 * input_string is the text (input_type = cw_bwt::text), the path of the text file (input_type = cw_bwt::path) or the path
+	 * of a FASTA/FASTQ/2-bit file (input_type = cw_bwt::sequence_path).
+	 * threads = 0: use all hardware threads
+	 */
+	sa_bwt(string &input_string, cw_bwt::cw_bwt_input_type input_type, bool verbose=false, uint threads=0){
+
+		this->verbose=verbose;
+
+		this->threads = threads;
+		if(this->threads==0)
+			this->threads = std::thread::hardware_concurrency();
+		if(this->threads==0)
+			this->threads = 1;
+
+		if(input_type==cw_bwt::path){
+
+			FileReader fr(input_string);
+			string text = fr.toString();
+			fr.close();
+
+			build(text);
+
+		}else if(input_type==cw_bwt::sequence_path){
+
+			SequenceFileReader fr(input_string,verbose);
+			string text = fr.toString();
+			fr.close();
+
+			build(text);
+
+		}else{
+
+			build(input_string);
+
+		}
+
+	}
+
+	string toString(){return bwt;}
+
+	void toFile(string path){//save bwt to file
+
+		FILE *fp;
+
+		if ((fp = fopen(path.c_str(), "wb")) == NULL) {
+			VERBOSE_CHANNEL<< "Cannot open file " << path << endl;
+			exit(1);
+		}
+
+		fwrite(bwt.data(), sizeof(uchar), bwt.length(), fp);
+
+		fclose(fp);
+
+	}
+
+	ulint length(){return n+1;};//length of text + terminator character
+
+	//bytes of RAM needed to build the BWT of a text of length n (text included)
+	static ulint memoryRequirement(ulint n){
+
+		ulint idx_bytes = (n+1 < ((ulint)1<<32) ? sizeof(uint32_t) : sizeof(uint64_t));
+
+		//text + BWT + SA + ranks + temporary keys (the initial 64-bit keys are freed before the temporary keys are allocated)
+		return 2*(n+1) + (n+1)*std::max(3*idx_bytes, 2*idx_bytes + sizeof(ulint));
+
+	}
+
+private:
+
+	struct group{
+
+		ulint begin;
+		ulint end;
+
+	};
+
+	void build(string &text){
+
+		n = text.length();
+
+		if(verbose) cout << "\nBuilding the BWT by suffix sorting (" << threads << " threads) ..." << endl;
+
+		if(n+1 < ((ulint)1<<32))
+			buildBWT<uint32_t>(text);
+		else
+			buildBWT<uint64_t>(text);
+
+		if(verbose) cout << "Done. " << endl;
+
+	}
+
+	template<typename idx_t>
+	void buildBWT(string &text){
+
+		ulint N = n+1;//suffixes, terminator included
+
+		vector<idx_t> SA(N);
+
+		suffixSort<idx_t>(text,SA);
+
+		if(verbose) cout << " Computing the BWT from the suffix array ... " << endl;
+
+		bwt = string(N,0);
+
+		parallelFor([&](uint t){
+
+			for(ulint j=(N*t)/threads;j<(N*(t+1))/threads;j++)
+				bwt[j] = (SA[j]==0 ? 0 : text[SA[j]-1]);
+
+		});
+
+	}
+
+	template<typename idx_t>
+	void suffixSort(string &text, vector<idx_t> &SA){
+
+		ulint N = n+1;
+
+		//remap alphabet to {1,...,sigma}; 0 is the terminator
+		vector<uchar> remap(256,0);
+		{
+			vector<bool> present(256,false);
+			for(ulint i=0;i<n;i++)
+				present[(uchar)text[i]] = true;
+
+			if(present[0]){
+				cout << "Error: the text contains a 0x0 byte." << endl;
+				exit(1);
+			}
+
+			uint sigma=0;
+			for(uint c=1;c<256;c++)
+				if(present[c])
+					remap[c] = ++sigma;
+
+			bits_per_char = intlog2(sigma);
+		}
+
+		ulint k = 64/bits_per_char;//characters packed in the initial keys
+
+		vector<idx_t> rank(N);
+		vector<group> groups;
+
+		{
+
+			if(verbose) cout << " Sorting suffixes by their first " << k << " characters ... " << endl;
+
+			vector<ulint> keys(N);
+
+			parallelFor([&](uint t){
+
+				ulint b = (N*t)/threads;
+				ulint e = (N*(t+1))/threads;
+
+				for(ulint i=b;i<e;i++){
+
+					ulint key=0;
+
+					for(ulint j=0;j<k;j++)
+						key = (key << bits_per_char) | (i+j<n ? remap[(uchar)text[i+j]] : 0);
+
+					keys[i] = key;
+					SA[i] = i;
+
+				}
+
+			});
+
+			parallelSort(SA.data(), SA.data()+N, [&](idx_t a, idx_t b){ return keys[a]<keys[b]; }, threads);
+
+			//ranks and groups
+			ulint head=0;
+			for(ulint j=0;j<N;j++){
+
+				if(j>0 and keys[SA[j]]!=keys[SA[j-1]]){
+
+					if(j-head>1)
+						groups.push_back({head,j});
+
+					head=j;
+
+				}
+
+				rank[SA[j]] = head;
+
+			}
+
+			if(N-head>1)
+				groups.push_back({head,N});
+
+		}//keys are freed
+
+		vector<idx_t> tmp(N);
+
+		ulint h = k;
+		uint round=0;
+
+		while(groups.size()>0){
+
+			if(verbose) cout << " Round " << ++round << ", h = " << h << ", unsorted groups = " << groups.size() << endl;
+
+			//large groups are sorted one at a time with all threads, small groups in parallel
+			ulint large = std::max((ulint)1<<16, N/(4*threads));
+
+			//phase 1: sort each group by the rank of the suffix h positions ahead, and store the keys in tmp.
+			//(suffixes in unsorted groups have no terminator in their first h characters, so SA[j]+h <= n)
+
+			auto key = [&](idx_t a){ return rank[a+h]; };
+			auto cmp = [&](idx_t a, idx_t b){ return rank[a+h] < rank[b+h]; };
+
+			for(auto g : groups)
+				if(g.end-g.begin > large){
+
+					parallelSort(SA.data()+g.begin, SA.data()+g.end, cmp, threads);
+
+					for(ulint j=g.begin;j<g.end;j++)
+						tmp[j] = key(SA[j]);
+
+				}
+
+			std::atomic<ulint> next_group(0);
+
+			parallelFor([&](uint){
+
+				ulint gi;
+				while((gi = next_group++) < groups.size()){
+
+					group g = groups[gi];
+
+					if(g.end-g.begin > large)
+						continue;
+
+					std::sort(SA.begin()+g.begin, SA.begin()+g.end, cmp);
+
+					for(ulint j=g.begin;j<g.end;j++)
+						tmp[j] = key(SA[j]);
+
+				}
+
+			});
+
+			//phase 2: update ranks and find the new unsorted groups (ranks are read only in phase 1)
+
+			vector<vector<group> > new_groups(threads);
+			next_group = 0;
+
+			parallelFor([&](uint t){
+
+				ulint gi;
+				while((gi = next_group++) < groups.size()){
+
+					group g = groups[gi];
+
+					ulint head = g.begin;
+
+					for(ulint j=g.begin;j<g.end;j++){
+
+						if(j>g.begin and tmp[j]!=tmp[j-1]){
+
+							if(j-head>1)
+								new_groups[t].push_back({head,j});
+
+							head=j;
+
+						}
+
+						rank[SA[j]] = head;
+
+					}
+
+					if(g.end-head>1)
+						new_groups[t].push_back({head,g.end});
+
+				}
+
+			});
+
+			groups.clear();
+
+			for(uint t=0;t<threads;t++)
+				groups.insert(groups.end(),new_groups[t].begin(),new_groups[t].end());
+
+			h *= 2;
+
+		}
+
+	}
+
+	//sort [begin,end) with 'threads' threads: each thread sorts a chunk, then chunks are merged pairwise in parallel
+	template<typename T, typename Compare>
+	static void parallelSort(T * begin, T * end, Compare comp, uint threads){
+
+		ulint len = end-begin;
+
+		if(threads==1 or len < ((ulint)1<<16)){
+
+			std::sort(begin,end,comp);
+			return;
+
+		}
+
+		vector<ulint> bounds(threads+1);
+		for(uint t=0;t<=threads;t++)
+			bounds[t] = (len*t)/threads;
+
+		{
+			vector<std::thread> pool;
+
+			for(uint t=0;t<threads;t++)
+				pool.push_back(std::thread([&,t](){ std::sort(begin+bounds[t],begin+bounds[t+1],comp); }));
+
+			for(auto &th : pool)
+				th.join();
+		}
+
+		while(bounds.size()>2){
+
+			vector<ulint> new_bounds;
+			vector<std::thread> pool;
+
+			for(ulint i=0;i+2<bounds.size();i+=2){
+
+				ulint b=bounds[i], m=bounds[i+1], e=bounds[i+2];
+				pool.push_back(std::thread([=](){ std::inplace_merge(begin+b,begin+m,begin+e,comp); }));
+
+				new_bounds.push_back(b);
+
+			}
+
+			if(bounds.size()%2==0)//odd number of chunks: the last one is not merged in this round
+				new_bounds.push_back(bounds[bounds.size()-2]);
+
+			new_bounds.push_back(bounds.back());
+
+			for(auto &th : pool)
+				th.join();
+
+			bounds = new_bounds;
+
+		}
+
+	}
+
+	//run f(t) for t=0,...,threads-1 in parallel
+	void parallelFor(std::function<void(uint)> f){
+
+		if(threads==1){
+			f(0);
+			return;
+		}
+
+		vector<std::thread> pool;
+
+		for(uint t=0;t<threads;t++)
+			pool.push_back(std::thread(f,t));
+
+		for(auto &th : pool)
+			th.join();
+
+	}
+
+	string bwt;
+
+	ulint n=0;//length of the text (without text terminator)
+	uint threads=1;
+	uint bits_per_char=1;
+
+	bool verbose=false;
+
+};
+
+} /* namespace bwtil */
+#endif /* SABWT_H_ */
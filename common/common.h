@@ -74,7 +74,7 @@ constexpr uint W_nodes = 256;
 
 typedef bitvector_t<W_leafs> bitv;
 
-enum input_mode {file_path,text};//input is a file path or a text string?
+enum input_mode {file_path,text,sequence_file_path};//input is a file path, a text string or the path of a FASTA/FASTQ/2-bit file?
 
 enum hash_type {DNA_SEARCH,BS_SEARCH,QUALITY_DNA_SEARCH,QUALITY_BS_SEARCH,DEFAULT};
 
@@ -0,0 +1,104 @@
+/*
+ *  This file is part of BWTIL.
+ *  Copyright (c) by
+ *  Nicola Prezza <nicolapr@gmail.com>
+ *
+ *   BWTIL is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+
+ *   BWTIL is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details (<http://www.gnu.org/licenses/>).
+ */
+
+/*
+ * BackwardSequenceIterator.h
+ *
+ *      Description: scans backwards the sequence contained in a FASTA, FASTQ (possibly gzipped) or 2-bit file (see
+ *      SequenceFile.h). As in BackwardFileIterator, the sequence is read in chunks of n/log^2(n) symbols from the end.
+ */
+
+#ifndef BACKWARDSEQUENCEITERATOR_H_
+#define BACKWARDSEQUENCEITERATOR_H_
+
+#include "../common/common.h"
+#include "BackwardIterator.h"
+#include "SequenceFile.h"
+
+namespace bwtil {
+
+class BackwardSequenceIterator : public BackwardIterator{
+
+public:
+
+	BackwardSequenceIterator(string &path, bool verbose=false){
+
+		sf = SequenceFile(path,verbose);
+
+		n = sf.size();
+
+		if (n == 0){
+			cout << "Error: file " << path << " contains no sequence." << endl;
+			exit(0);
+		}
+
+		bufferSize = n/(ulint)(log2(n+1)*log2(n+1));
+		if(bufferSize==0)
+			bufferSize = 1;
+
+		buffer = vector<symbol>(bufferSize);
+
+		rewind();
+
+	}
+
+	void rewind(){//go back to the end of the sequence
+
+		position = n;
+		buffer_start = n;
+
+	}
+
+	symbol read(){
+
+		if(position==0)
+			return 0;
+
+		position--;
+
+		if(position<buffer_start){//read the previous chunk
+
+			buffer_start = (position+1>bufferSize ? position+1-bufferSize : 0);
+			sf.read(buffer_start, buffer.data(), position+1-buffer_start);
+
+		}
+
+		return buffer[position-buffer_start];
+
+	}
+
+	bool begin(){return position==0;};//no more symbols to be read
+
+	void close(){sf.close();};
+
+	ulint length(){return n;};
+
+private:
+
+	SequenceFile sf;
+
+	ulint n;
+	ulint bufferSize;//n/(log^2(n))
+
+	vector<symbol> buffer;//sequence[buffer_start,...,buffer_start+bufferSize-1]
+	ulint buffer_start;
+
+	ulint position;//1 step ahead of the next position to be read
+
+};
+
+} /* namespace bwtil */
+#endif /* BACKWARDSEQUENCEITERATOR_H_ */
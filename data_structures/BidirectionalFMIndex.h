@@ -0,0 +1,473 @@
+/*
+ *  This file is part of BWTIL.
+ *  Copyright (c) by
+ *  Nicola Prezza <nicolapr@gmail.com>
+ *
+ *   BWTIL is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+
+ *   BWTIL is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details (<http://www.gnu.org/licenses/>).
+ */
+
+/*
+ * BidirectionalFMIndex.h
+ *
+ *  Description: a bidirectional wavelet-tree based FM index. Stores the BWT of the text and the BWT of the reversed text,
+ *  so that the interval of a pattern can be extended both to the left and to the right.
+ *
+ *  On top of the bidirectional index, approximate (Hamming distance) search is implemented with search schemes:
+ *  the pattern is split in parts and each search of the scheme visits the parts in a given order, with lower and upper
+ *  bounds on the cumulative number of mismatches after each part. This prunes the backtracking much earlier than
+ *  a unidirectional search, where all errors can be in the first characters searched.
+ *
+ *  Only the forward index stores SA samples (locate is always performed on the forward BWT).
+ *
+ */
+
+#ifndef BIDIRECTIONALFMINDEX_H_
+#define BIDIRECTIONALFMINDEX_H_
+
+#include "IndexedBWT.h"
+#include "FileReader.h"
+#include "../algorithms/bwt_builder.h"
+
+namespace bwtil {
+
+class BidirectionalFMIndex {
+
+public:
+
+	/*
+	 * a pattern occurrence in the bidirectional index: interval of P on the BWT of the text and interval of reverse(P) on the BWT of the
+	 * reversed text. Both intervals have the same size (number of occurrences).
+	 */
+	struct bi_interval{
+
+		pair<ulint, ulint> fwd;
+		pair<ulint, ulint> rev;
+
+		ulint size(){return fwd.second-fwd.first;}
+		bool empty(){return fwd.second<=fwd.first;}
+
+	};
+
+	/*
+	 * a search of a search scheme. The pattern is split in pi.size() parts, numbered from 0 (leftmost part).
+	 * Parts are searched in the order pi[0], pi[1], ... . pi must be connected: every pi[j] is adjacent to the block
+	 * of parts already searched. After searching part pi[j], the number of mismatches must lie in [L[j], U[j]].
+	 */
+	struct search_t{
+
+		vector<uint> pi;
+		vector<uint> L;
+		vector<uint> U;
+
+	};
+
+	BidirectionalFMIndex(){};
+
+	BidirectionalFMIndex(string text, bool verbose = false){
+
+		build(text,verbose);
+
+	}
+
+	static BidirectionalFMIndex buildFromFile(string path, bool verbose = false){
+
+		FileReader fr = FileReader(path);
+		string text = fr.toString();
+		fr.close();
+
+		return BidirectionalFMIndex(text,verbose);
+
+	}
+
+	//interval of the empty pattern
+	bi_interval fullInterval(){
+
+		bi_interval I;
+
+		I.fwd = pair<ulint, ulint>(0,fwd_idx.length());
+		I.rev = pair<ulint, ulint>(0,rev_idx.length());
+
+		return I;
+
+	}
+
+	//from the interval of P, compute the interval of cP
+	bi_interval extendLeft(bi_interval I, uchar c){
+
+		if(not fwd_idx.inAlphabet(c))
+			return emptyInterval();
+
+		ulint smaller = fwd_idx.smallerSymbols(c, I.fwd.first, I.fwd.second);
+
+		I.fwd = fwd_idx.exact_match(c, I.fwd.first, I.fwd.second);
+
+		I.rev.first = I.rev.first + smaller;
+		I.rev.second = I.rev.first + I.size();
+
+		return I;
+
+	}
+
+	//from the interval of P, compute the interval of Pc
+	bi_interval extendRight(bi_interval I, uchar c){
+
+		if(not rev_idx.inAlphabet(c))
+			return emptyInterval();
+
+		ulint smaller = rev_idx.smallerSymbols(c, I.rev.first, I.rev.second);
+
+		I.rev = rev_idx.exact_match(c, I.rev.first, I.rev.second);
+
+		I.fwd.first = I.fwd.first + smaller;
+		I.fwd.second = I.fwd.first + (I.rev.second-I.rev.first);
+
+		return I;
+
+	}
+
+	//exact search of P
+	bi_interval BS(string &P){
+
+		bi_interval I = fullInterval();
+
+		for(ulint i=0;i<P.length() and not I.empty();i++)
+			I = extendLeft(I, (uchar)P.at(P.length()-1-i));
+
+		return I;
+
+	}
+
+	vector<ulint> getOccurrencies(string P){
+
+		return fwd_idx.convertToTextCoordinates( BS(P).fwd );
+
+	}
+
+	/*
+	 * search scheme for k mismatches. For k<=2 the optimal schemes of Kianfar et al. (2017) are returned.
+	 * For larger k, the pigeonhole scheme with k+1 parts: one search per part, with the part matched exactly first.
+	 */
+	static vector<search_t> searchScheme(uint k){
+
+		if(k==0)
+			return { {{0},{0},{0}} };
+
+		if(k==1)
+			return {	{{0,1},{0,0},{0,1}},
+						{{1,0},{0,1},{0,1}} };
+
+		if(k==2)
+			return {	{{0,1,2},{0,0,0},{0,2,2}},
+						{{2,1,0},{0,0,0},{0,1,2}},
+						{{1,0,2},{0,1,1},{0,1,2}} };
+
+		vector<search_t> scheme;
+
+		uint parts = k+1;
+
+		for(uint i=0;i<parts;i++){
+
+			search_t S;
+
+			for(uint j=i;j<parts;j++)
+				S.pi.push_back(j);
+
+			for(uint j=i;j>0;j--)
+				S.pi.push_back(j-1);
+
+			S.L = vector<uint>(parts,0);
+			S.U = vector<uint>(parts,k);
+			S.U[0] = 0;
+
+			scheme.push_back(S);
+
+		}
+
+		return scheme;
+
+	}
+
+	/*
+	 * search P with at most k mismatches (Hamming distance) using the search scheme 'scheme' (default: searchScheme(k)).
+	 * returns the intervals of all the distinct strings at distance <= k from P that occur in the text (one interval per string)
+	 */
+	vector<bi_interval> approximateIntervals(string &P, uint k, vector<search_t> scheme = vector<search_t>()){
+
+		if(scheme.size()==0)
+			scheme = searchScheme(k);
+
+		uint parts = scheme[0].pi.size();
+
+		//pattern too short to be split: plain backtracking
+		if(P.length()<parts){
+
+			parts = 1;
+			scheme = { {{0},{0},{k}} };
+
+		}
+
+		vector<bi_interval> result;
+
+		//part p covers pattern positions [part_start[p],part_start[p+1])
+		vector<ulint> part_start(parts+1);
+		for(uint p=0;p<=parts;p++)
+			part_start[p] = (P.length()*p)/parts;
+
+		for(auto S : scheme){
+
+			//flatten the search: sequence of pattern positions, extension direction and part index (in pi order)
+			vector<search_step> steps;
+
+			uint hi = S.pi[0];//rightmost part searched so far
+
+			for(uint j=0;j<S.pi.size();j++){
+
+				uint p = S.pi[j];
+
+				//the first part is searched leftwards; the others in the direction of their position wrt the searched block
+				bool right = j>0 and p>hi;
+
+				if(right){
+
+					for(ulint i=part_start[p];i<part_start[p+1];i++)
+						steps.push_back({i,true,j,i+1==part_start[p+1]});
+
+					hi = p;
+
+				}else{
+
+					for(ulint i=part_start[p+1];i>part_start[p];i--)
+						steps.push_back({i-1,false,j,i-1==part_start[p]});
+
+				}
+
+			}
+
+			searchRecursive(P,S,steps,0,0,fullInterval(),result);
+
+		}
+
+		//different searches can find the same string: remove duplicates
+		std::sort(result.begin(),result.end(),[](const bi_interval &a, const bi_interval &b){ return a.fwd<b.fwd; });
+
+		vector<bi_interval> unique_result;
+
+		for(auto I : result)
+			if(unique_result.size()==0 or unique_result.back().fwd != I.fwd)
+				unique_result.push_back(I);
+
+		return unique_result;
+
+	}
+
+	/*
+	 * returns sorted text positions of all occurrences of P with at most k mismatches
+	 */
+	vector<ulint> getApproximateOccurrencies(string P, uint k, vector<search_t> scheme = vector<search_t>()){
+
+		vector<ulint> occ;
+
+		for(auto I : approximateIntervals(P,k,scheme)){
+
+			vector<ulint> o = fwd_idx.convertToTextCoordinates(I.fwd);
+			occ.insert(occ.end(),o.begin(),o.end());
+
+		}
+
+		std::sort(occ.begin(),occ.end());
+
+		return occ;
+
+	}
+
+	ulint size(){//returns size of the structure in bits
+
+		return fwd_idx.size() + rev_idx.size();
+
+	}
+
+	ulint textLength(){return n;};
+
+	void saveToFile(string path){
+
+		FILE *fp;
+
+		if ((fp = fopen(path.c_str(), "wb")) == NULL) {
+			VERBOSE_CHANNEL<< "Cannot open file " << path<<endl;
+			exit(1);
+		}
+
+		saveToFile(fp);
+
+		fclose(fp);
+
+	}
+
+	void load(string path){
+
+		FILE *fp;
+
+		if ((fp = fopen(path.c_str(), "rb")) == NULL) {
+			VERBOSE_CHANNEL<< "Cannot open file "  << path<<endl;
+			exit(1);
+		}
+
+		loadFromFile(fp);
+
+		fclose(fp);
+
+	}
+
+	void saveToFile(FILE *fp){
+
+		fwrite(&n, sizeof(ulint), 1, fp);
+		fwrite(&offrate, sizeof(ulint), 1, fp);
+
+		fwd_idx.saveToFile(fp);
+		rev_idx.saveToFile(fp);
+
+	}
+
+	void loadFromFile(FILE *fp){
+
+		ulint numBytes;
+
+		numBytes = fread(&n, sizeof(ulint), 1, fp);
+		assert(numBytes>0);
+		numBytes = fread(&offrate, sizeof(ulint), 1, fp);
+		assert(numBytes>0);
+
+		fwd_idx.loadFromFile(fp);
+		rev_idx.loadFromFile(fp);
+
+		numBytes++;//avoids "variable not used" warning
+
+	}
+
+	static BidirectionalFMIndex loadFromFile(string path){
+
+		BidirectionalFMIndex bfmi = BidirectionalFMIndex();
+		bfmi.load(path);
+		return bfmi;
+
+	}
+
+private:
+
+	//one character of a search: pattern position, direction, index j of the part in pi, last character of the part?
+	struct search_step{
+
+		ulint position;
+		bool right;
+		uint j;
+		bool end_of_part;
+
+	};
+
+	bi_interval emptyInterval(){
+
+		bi_interval I;
+
+		I.fwd = pair<ulint, ulint>(0,0);
+		I.rev = pair<ulint, ulint>(0,0);
+
+		return I;
+
+	}
+
+	void searchRecursive(string &P, search_t &S, vector<search_step> &steps, ulint t, uint errors, bi_interval I, vector<bi_interval> &result){
+
+		if(t==steps.size()){
+
+			result.push_back(I);
+			return;
+
+		}
+
+		search_step st = steps[t];
+		uchar p = (uchar)P.at(st.position);
+
+		for(uint i=0;i<fwd_idx.alphabetSize();i++){
+
+			uchar c = fwd_idx.inverseRemap(i);
+			uint e = errors + (c!=p);
+
+			if(e > S.U[st.j])
+				continue;
+
+			if(st.end_of_part and e < S.L[st.j])
+				continue;
+
+			bi_interval J = st.right ? extendRight(I,c) : extendLeft(I,c);
+
+			if(not J.empty())
+				searchRecursive(P,S,steps,t+1,e,J,result);
+
+		}
+
+	}
+
+	void build(string &text, bool verbose){
+
+		n = text.length();
+
+		string bwt;
+		string rev_bwt;
+
+		{
+
+			if(verbose) cout << " Computing the BWT ... " << flush;
+			bwt = bwt_builder::toString(text,cw_bwt::text,verbose);
+			if(verbose) cout << "done." << endl;
+
+			string rev_text(text.rbegin(),text.rend());
+
+			if(verbose) cout << " Computing the BWT of the reversed text ... " << flush;
+			rev_bwt = bwt_builder::toString(rev_text,cw_bwt::text,verbose);
+			if(verbose) cout << "done." << endl;
+
+		}
+
+		//detect alphabet size
+		uint sigma=0;
+		vector<bool> symbols(256,false);
+		for(ulint i=0;i<n;i++)
+			if(not symbols.at((uchar)text[i])){
+
+				sigma++;
+				symbols.at((uchar)text[i]) = true;
+
+			}
+
+		uint log_sigma = ceil(log2(sigma));
+		if(log_sigma==0)
+			log_sigma=1;
+
+		uint log_n = ceil(log2(n));
+		double epsilon = 0.1;
+
+		offrate = ceil( pow(log_n,1+epsilon)/(double)log_sigma );//same sampling of succinctFMIndex
+
+		fwd_idx = IndexedBWT(bwt,offrate,verbose);
+		rev_idx = IndexedBWT(rev_bwt,0,verbose);//no locate on the reversed text
+
+	}
+
+	IndexedBWT fwd_idx;//BWT of the text
+	IndexedBWT rev_idx;//BWT of the reversed text
+
+	ulint n=0;//text length (excluded terminator character 0x0)
+	ulint offrate=0;
+
+};
+
+} /* namespace bwtil */
+#endif /* BIDIRECTIONALFMINDEX_H_ */
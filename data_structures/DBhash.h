@@ -25,9 +25,11 @@
 #define DBHASH_H_
 
 #include "../common/common.h"
+#include <memory>
 #include "HashFunction.h"
 #include "IndexedBWT.h"
-#include "../algorithms/cw_bwt.h"
+#include "OccurrenceCache.h"
+#include "../algorithms/bwt_builder.h"
 
 namespace bwtil {
 
@@ -41,27 +43,9 @@ public:
 
 		if(verbose)	cout << "\nBuilding dB-hash data structure" <<endl;
 
-		this->n = text.length();
-		this->h = h;
-		this->offrate = offrate;
-
-		m = h.m;
-		w = h.w;
-
-		text_fingerprint_length = n-m+w;
-
-		if(verbose) cout << " Text fingerprint length = " << text_fingerprint_length<<endl;
-
-		w_aux = ceil( ( log2(n) - log2(log2(n)) )/log2(h.base) );//log_b n - log_b log_2 n
+		init(text.length(),h,offrate,verbose);
 
-		if(w_aux>w) w_aux=w;
-
-		auxiliary_hash_size = 1 << (w_aux * h.log_base);
-
-		if(verbose)	cout << " w = " << w <<endl;
-		if(verbose)	cout << " w_aux = " << w_aux <<endl;
-
-		cw_bwt * cwbwt;
+		string bwt;
 
 		{
 
@@ -71,24 +55,17 @@ public:
 
 			if(verbose)	cout << " Computing BWT(h(T))  ..." <<flush;
 
-			cwbwt = new cw_bwt(fingerprint,cw_bwt::text,verbose);
+			bwt = bwt_builder::toString(fingerprint,cw_bwt::text,verbose);
 
 			if(verbose)	cout << " Done.\n";
 
 		}//fingerprint is deleted
 
-		{
-
-			string bwt = cwbwt->toString();
-
-			delete cwbwt;
-
-			indexedBWT =  IndexedBWT(bwt,offrate,verbose);
-
-		}//bwt is deleted
+		indexedBWT =  IndexedBWT(bwt,offrate,verbose);
+		string().swap(bwt);//free memory
 
 		if(verbose)	cout << " Storing text T in plain format ...";
-		initText(text);
+		initText([&](ulint i, uchar * buf, ulint len){ memcpy(buf, text.data()+i, len); });
 		if(verbose)	cout << " Done.\n";
 
 		if(verbose)	cout << "\n  Building auxiliary hash ... " << endl;
@@ -99,6 +76,40 @@ public:
 
 	}
 
+	/*
+	 * input = text (mode = text), path of the text file (mode = file_path) or path of a FASTA/FASTQ/2-bit file whose sequences
+	 * are the text (mode = sequence_file_path, see SequenceFile.h).
+	 *
+	 * With mode = file_path or sequence_file_path the dB-hash is built streaming from disk: the fingerprint h(T) is written to the
+	 * temporary file input.fp.tmp, its BWT is built in compressed space (cw_bwt) and written to input.bwt.tmp, and the indexed BWT
+	 * and the packed text are filled reading these files sequentially. Neither the text, nor h(T), nor its BWT is ever loaded in RAM:
+	 * peak memory is close to the size of the final structure (or of cw_bwt, if larger).
+	 */
+	DBhash(string &input, input_mode mode, HashFunction h, ulint offrate = 16, bool verbose = false){
+
+		if(mode==text){
+			*this = DBhash(input,h,offrate,verbose);
+			return;
+		}
+
+		if(verbose)	cout << "\nBuilding dB-hash data structure (streaming from disk)" <<endl;
+
+		if(mode==sequence_file_path){
+
+			SequenceFileReader fr(input,verbose);
+			build(fr,input,h,offrate,verbose);
+			fr.close();
+
+		}else{
+
+			FileReader fr(input);
+			build(fr,input,h,offrate,verbose);
+			fr.close();
+
+		}
+
+	}
+
 	//doesn't use auxiliary hash.
 	vector<ulint> getOccurrences_slow(ulint fingerprint){
 
@@ -106,27 +117,60 @@ public:
 
 	}
 
-	//returns occurrences in the text of substrings having 'fingerprint' as hash value. uses the auxiliary hash.
+	//returns occurrences in the text of substrings having 'fingerprint' as hash value. uses the auxiliary hash (and the cache, if enabled).
 	vector<ulint> getOccurrences(ulint fingerprint){
 
+		OccurrenceCache::entry e;
+
+		if(cache and cache->find(fingerprint,e))
+			return e.located ? e.occ : indexedBWT.convertToTextCoordinates( e.interval );
+
 		ulint mask = auxiliary_hash_size-1;
 
 		ulint suffix = fingerprint & mask;//suffix of length w_aux. Searched in the auxiliary hash
 		ulint prefix = fingerprint >> (w_aux*h.log_base);//prefix of the fingerprint of length log m/log base to be searched with backward search
 
-		pair<ulint, ulint> interval;
-
-		interval.first = auxiliary_hash[suffix];
+		pair<ulint, ulint> interval = auxHashInterval(suffix);
 
-		if (suffix + 1 == auxiliary_hash_size)
-			interval.second = text_fingerprint_length + 1;
+		if(interval.second>interval.first)
+			interval = indexedBWT.BS(prefix,w-w_aux,interval);
 		else
-			interval.second = auxiliary_hash[suffix+1];
+			interval.second = interval.first;
+
+		vector<ulint> occ = indexedBWT.convertToTextCoordinates( interval );
+
+		if(cache){
 
-		return indexedBWT.convertToTextCoordinates( indexedBWT.BS(prefix,w-w_aux,interval) );
+			e.interval = interval;
+			e.located = cache->admitList(interval);
+
+			if(e.located)
+				e.occ = occ;
+
+			cache->insert(fingerprint,e);
+
+		}
+
+		return occ;
 
 	}
 
+	/*
+	 * enable a cache of fingerprint lookups, shared by all the threads searching this structure (and by its copies).
+	 * budget = cache size in bytes. Fingerprints with more than max_list_length occurrences are cached as BWT intervals
+	 * (the backward search is saved, not the locate).
+	 */
+	void enableCache(ulint budget, ulint max_list_length=64){
+
+		cache = std::make_shared<OccurrenceCache>(budget,max_list_length);
+
+	}
+
+	void disableCache(){cache.reset();}
+
+	//NULL if the cache is not enabled
+	OccurrenceCache * occurrenceCache(){return cache.get();}
+
 	//returns number of occurrences of the fingerprint. uses the auxiliary hash.
 	ulint numberOfOccurrences(ulint fingerprint){
 
@@ -135,14 +179,7 @@ public:
 		ulint suffix = fingerprint & mask;//suffix of length w_aux. Searched in the auxiliary hash
 		ulint prefix = fingerprint >> (w_aux*h.log_base);//prefix of the fingerprint of length log m/log base to be searched with backward search
 
-		pair<ulint, ulint> interval;
-
-		interval.first = auxiliary_hash[suffix];
-
-		if (suffix + 1 == auxiliary_hash_size)
-			interval.second = text_fingerprint_length + 1;
-		else
-			interval.second = auxiliary_hash[suffix+1];
+		pair<ulint, ulint> interval = auxHashInterval(suffix);
 
 		interval = indexedBWT.BS(prefix,w-w_aux,interval);
 
@@ -158,14 +195,7 @@ public:
 		ulint suffix = fingerprint & mask;//suffix of length w_aux. Searched in the auxiliary hash
 		ulint prefix = fingerprint >> (w_aux*h.log_base);//prefix of the fingerprint of length log m/log base to be searched with backward search
 
-		pair<ulint, ulint> interval;
-
-		interval.first = auxiliary_hash[suffix];
-
-		if (suffix + 1 == auxiliary_hash_size)
-			interval.second = text_fingerprint_length + 1;
-		else
-			interval.second = auxiliary_hash[suffix+1];
+		pair<ulint, ulint> interval = auxHashInterval(suffix);
 
 		interval = indexedBWT.BS(prefix,w-w_aux,interval);
 
@@ -176,27 +206,32 @@ public:
 
 	}
 
-	//result[i] = number of hash lists with >= than i entries.
-	//max number of entries detected=10000
-	//result[10000] = number of hash lists with > than 10000 entries.
+	//result[i] = number of hash lists with i entries (i.e. fingerprints with i occurrences).
+	//max number of entries detected=max_length
+	//result[max_length] = number of hash lists with >= than max_length entries.
 	//can be used for statistics.
-	vector<ulint> hashLoad(){
-
-		ulint hash_size = ((ulint)1)<<(w*log_sigma);//number of hash entries
-		ulint max_length = 10000;//max length detected
+	//Only the fingerprints that occur in the text are visited: each auxiliary hash bucket (an interval of the F column) is refined
+	//by one backward search step per digit, so the time is proportional to the text (O(n*b*(w-w_aux)) rank operations) instead of
+	//to the number b^w of fingerprints.
+	vector<ulint> hashLoad(ulint max_length = 10000){
 
 		vector<ulint> stats(max_length+1,0);
 
-		for(ulint i=0;i<hash_size;i++){
+		ulint occurring=0;//number of fingerprints that occur in the text
 
-			ulint occ = numberOfOccurrences(i);
-			if(occ<max_length)
-				stats[occ]++;
-			else
-				stats[max_length]++;
+		for(ulint s=0;s<auxiliary_hash_size;s++){
+
+			pair<ulint, ulint> bucket = auxHashInterval(s);
+
+			if(bucket.second>bucket.first)
+				refineLoad(bucket, w-w_aux, stats, occurring);
 
 		}
 
+		ulint hash_size = (w*h.log_base>=64 ? ~((ulint)0) : ((ulint)1)<<(w*h.log_base));//number of hash entries
+
+		stats[0] += hash_size-occurring;
+
 		return stats;
 
 	}
@@ -329,36 +364,161 @@ public:
 
 	}
 
+	/*
+	 * returns the (sorted) occurrences of P at Hamming distance at most max_errors. The fingerprints h(P) XOR z, for all z in the
+	 * sets Z(0),...,Z(max_errors) of the hash function, are searched: a mismatch in P changes the fingerprint by an element of Z(1).
+	 * The Z set is built up to radius 2: with more errors, only the occurrences whose fingerprint is within radius 2 are found.
+	 * P can be longer than the pattern length m of the structure: in this case, P is searched by seeds of length m (see search).
+	 */
 	vector<ulint> getOccurrencies(string &P, uint max_errors=0){
 
-		if(P.length()!=m){
-			cerr << "Error: Searching pattern of length " << P.length() << " in a dB-hash with pattern length " << m<<endl;
-			exit(1);
+		return search(P, max_errors, NULL);
+
+	}
+
+	//time (seconds) spent in each stage of the search, accumulated over the queries
+	struct query_stats{
+
+		double hash=0;
+		double aux_lookup=0;
+		double backward_search=0;
+		double locate=0;
+		double verification=0;
+
+		ulint queries=0;
+		ulint fingerprints=0;//fingerprints searched (neighbourhood of h(P))
+		ulint candidates=0;//occurrences of the fingerprints
+		ulint occurrences=0;//occurrences after verification
+
+		void add(query_stats &s){
+
+			hash += s.hash;
+			aux_lookup += s.aux_lookup;
+			backward_search += s.backward_search;
+			locate += s.locate;
+			verification += s.verification;
+
+			queries += s.queries;
+			fingerprints += s.fingerprints;
+			candidates += s.candidates;
+			occurrences += s.occurrences;
+
 		}
 
-		return filterOutBadOccurrences(P, getOccurrences(h.hashValue(P)), max_errors);
+	};
+
+	/*
+	 * same as getOccurrencies(P,max_errors), but accumulates in 'stats' the time spent in each stage.
+	 * The structure is only read: this method can be called concurrently by multiple threads (one query_stats per thread)
+	 */
+	vector<ulint> getOccurrencies(string &P, uint max_errors, query_stats &stats){
+
+		return search(P, max_errors, &stats);
 
 	}
 
 	//given a pattern, a list of (candidate) occurrencies and a maximum number of errors (Hamming distance), filter out occurrencies at distance > max_errors
+	//The pattern is packed once in the layout of text_wv, then compared with the text 64 bits at a time (see mismatches())
 	vector<ulint> filterOutBadOccurrences(string &P, vector<ulint> occ, uint max_errors){
 
 		vector<ulint> good;
 
-		ulint dist=0;
-		ulint s;//shift in text
+		packed_pattern pp = packPattern(P);
+
+		for(ulint i=0;i<occ.size();i++)
+			if(mismatches(pp, occ.at(i), max_errors)<=max_errors)
+				good.push_back(occ.at(i));
+
+		return good;
+
+	}
+
+	ulint textLength(){return n;}
+	ulint patternLength(){return m;}
+	uint auxiliaryHashDigits(){return w_aux;}
+
+	HashFunction hashFunction(){return h;}
+
+protected:
+
+	/*
+	 * patterns longer than m are split in s = |P|/m disjoint seeds of length m (the last |P| mod m characters are not used as seed).
+	 * If P occurs with at most max_errors errors, then at least one seed occurs with at most max_errors/s errors (pigeonhole):
+	 * each seed is searched with max_errors/s errors, and the candidate occurrences are verified against the whole pattern.
+	 * In this way an index built for pattern length m serves all the pattern lengths >= m.
+	 */
+	vector<ulint> search(string &P, uint max_errors, query_stats *stats){
+
+		using std::chrono::high_resolution_clock;
+		using std::chrono::duration;
+
+		if(P.length()<m){
+			cerr << "Error: Searching pattern of length " << P.length() << " in a dB-hash with pattern length " << m<<endl;
+			exit(1);
+		}
+
+		ulint seeds = P.length()/m;
+		uint seed_errors = max_errors/seeds;
 
-		for(ulint i=0;i<occ.size();i++){
+		auto t_hash = high_resolution_clock::now();
 
-			dist = 0;
-			s = occ.at(i);
+		//fingerprint of each seed (seed j is the window of P starting at j*m). With more than one seed, the rolling
+		//fingerprints of all the windows are computed in one pass over P. Quality fingerprints do not roll: one per seed
+		vector<ulint> seed_fingerprints(seeds);
 
-			for(ulint j=0;j<P.length() and dist<=max_errors;j++)
-				if((uchar)P.at(j) != textAt(s+j))
-					dist++;
+		if(seeds>1 and h.type!=QUALITY_DNA_SEARCH and h.type!=QUALITY_BS_SEARCH){
 
-			if(dist<=max_errors)
-				good.push_back(s);
+			vector<ulint> windows = h.hashValues(P);
+
+			for(ulint j=0;j<seeds;j++)
+				seed_fingerprints[j] = windows[j*m];
+
+		}else{
+
+			for(ulint j=0;j<seeds;j++){
+
+				string seed = P.substr(j*m,m);
+				seed_fingerprints[j] = h.hashValue(seed);
+
+			}
+
+		}
+
+		if(stats!=NULL)
+			stats->hash += duration<double>(high_resolution_clock::now()-t_hash).count();
+
+		vector<ulint> occ;
+
+		for(ulint j=0;j<seeds;j++){
+
+			vector<ulint> seed_occ = candidates(seed_fingerprints[j], seed_errors, stats);
+
+			for(auto o : seed_occ)
+				if(o>=j*m and o-j*m+P.length()<=n)//occurrence of the whole pattern must be inside the text
+					occ.push_back(o-j*m);
+
+		}
+
+		//a pattern occurrence can be a candidate of more than one seed
+		if(seeds>1){
+			std::sort(occ.begin(),occ.end());
+			occ.erase(std::unique(occ.begin(),occ.end()),occ.end());
+		}
+
+		auto t0 = high_resolution_clock::now();
+
+		vector<ulint> good = filterOutBadOccurrences(P, occ, max_errors);
+		std::sort(good.begin(),good.end());
+
+		auto t1 = high_resolution_clock::now();
+
+		if(stats!=NULL){
+
+			stats->verification += duration<double>(t1-t0).count();
+
+			stats->queries++;
+			stats->candidates += occ.size();
+			stats->occurrences += good.size();
 
 		}
 
@@ -366,14 +526,358 @@ public:
 
 	}
 
-	ulint textLength(){return n;}
-	ulint patternLength(){return m;}
+	//candidate occurrences of a pattern of length m with fingerprint h(P): occurrences of the fingerprints at distance at most max_errors from h(P)
+	vector<ulint> candidates(ulint fingerprint, uint max_errors, query_stats *stats){
 
-	HashFunction hashFunction(){return h;}
+		using std::chrono::high_resolution_clock;
+		using std::chrono::duration;
 
-protected:
+		auto t0 = high_resolution_clock::now();
+
+		//neighbourhood of the fingerprint. Quality hash values are not XOR-based: only exact fingerprint
+		vector<ulint> fingerprints;
+
+		if(h.type==QUALITY_DNA_SEARCH or h.type==QUALITY_BS_SEARCH){
+
+			fingerprints.push_back(fingerprint);
+
+		}else{
+
+			HashFunction::SetZIterator z_it = h.getSetZIterator();
+
+			while(z_it.hasNext() and z_it.getNextErrors()<=max_errors)
+				fingerprints.push_back(fingerprint ^ z_it.nextElement());
+
+		}
+
+		//group fingerprints by auxiliary hash bucket (suffix of length w_aux): each bucket is looked up once
+		ulint mask = auxiliary_hash_size-1;
+		std::sort(fingerprints.begin(),fingerprints.end(),[mask](ulint a, ulint b){
+			return (a&mask)<(b&mask) or ((a&mask)==(b&mask) and a<b);
+		});
+		fingerprints.erase(std::unique(fingerprints.begin(),fingerprints.end()),fingerprints.end());
+
+		auto t1 = high_resolution_clock::now();
+
+		double aux_time=0, bs_time=0;
+
+		vector<pair<ulint, ulint> > intervals;//intervals to be located
+		vector<ulint> interval_fingerprints;//fingerprint of each interval
+		vector<bool> cache_list;//cache the located occurrences of the interval?
+
+		//candidates. Distinct fingerprints have disjoint intervals: candidates are distinct
+		vector<ulint> occ;
+
+		for(ulint i=0;i<fingerprints.size();){
+
+			ulint suffix = fingerprints[i] & mask;
+
+			pair<ulint, ulint> bucket;
+			bool bucket_read = false;
+
+			for(;i<fingerprints.size() and (fingerprints[i]&mask)==suffix;i++){
+
+				ulint f = fingerprints[i];
+
+				OccurrenceCache::entry e;
+
+				if(cache and cache->find(f,e)){
+
+					if(e.located)
+						occ.insert(occ.end(),e.occ.begin(),e.occ.end());
+					else{
+						intervals.push_back(e.interval);
+						interval_fingerprints.push_back(f);
+						cache_list.push_back(false);
+					}
+
+					continue;
+
+				}
+
+				if(not bucket_read){
+
+					auto t_a = high_resolution_clock::now();
+
+					bucket = auxHashInterval(suffix);
+					bucket_read = true;
+
+					aux_time += duration<double>(high_resolution_clock::now()-t_a).count();
+
+				}
+
+				auto t_b = high_resolution_clock::now();
+
+				pair<ulint, ulint> interval(bucket.first,bucket.first);
+
+				if(bucket.second>bucket.first)
+					interval = indexedBWT.BS(f >> (w_aux*h.log_base),w-w_aux,bucket);
+
+				bs_time += duration<double>(high_resolution_clock::now()-t_b).count();
+
+				bool admit_list = (cache and cache->admitList(interval));
+
+				if(cache and not admit_list){
+
+					e.interval = interval;
+					cache->insert(f,e);
+
+				}
+
+				if(interval.second>interval.first){
 
-	void initText(string &text){
+					intervals.push_back(interval);
+					interval_fingerprints.push_back(f);
+					cache_list.push_back(admit_list);
+
+				}else if(admit_list){
+
+					e.interval = interval;
+					e.located = true;
+					cache->insert(f,e);
+
+				}
+
+			}
+
+		}
+
+		auto t2 = high_resolution_clock::now();
+
+		for(ulint k=0;k<intervals.size();k++){
+
+			vector<ulint> o = indexedBWT.convertToTextCoordinates( intervals[k] );
+			occ.insert(occ.end(),o.begin(),o.end());
+
+			if(cache_list[k]){
+
+				OccurrenceCache::entry e;
+				e.interval = intervals[k];
+				e.located = true;
+				e.occ = o;
+
+				cache->insert(interval_fingerprints[k],e);
+
+			}
+
+		}
+
+		auto t3 = high_resolution_clock::now();
+
+		if(stats!=NULL){
+
+			stats->hash += duration<double>(t1-t0).count();
+			stats->aux_lookup += aux_time;
+			stats->backward_search += bs_time;
+			stats->locate += duration<double>(t3-t2).count();
+
+			stats->fingerprints += fingerprints.size();
+
+		}
+
+		return occ;
+
+	}
+
+	//pattern packed with log_sigma bits per symbol, in chunks of at most 64 bits (whole symbols)
+	struct packed_pattern{
+
+		vector<ulint> words;//packed symbols
+		vector<ulint> absent;//non-zero fields: symbols that do not occur in the text (always a mismatch)
+		vector<uint> bits;//bits used in each chunk
+
+		ulint low_bits=0;//lowest bit of each field
+
+	};
+
+	packed_pattern packPattern(string &P){
+
+		packed_pattern pp;
+
+		uint symbols_per_word = 64/log_sigma;
+
+		//pack with the same layout of text_wv, so that chunks can be compared directly
+		packed_view_t codes(log_sigma,P.length());
+		packed_view_t absent(log_sigma,P.length());
+
+		for(ulint j=0;j<P.length();j++){
+
+			uint c = char_to_int[(uchar)P.at(j)];
+
+			codes[j] = (c<sigma ? c : 0);
+			absent[j] = (c<sigma ? 0 : 1);
+
+		}
+
+		for(ulint j=0;j<P.length();j+=symbols_per_word){
+
+			ulint begin = j*log_sigma;
+			ulint end = std::min(j+symbols_per_word,(ulint)P.length())*log_sigma;
+
+			pp.words.push_back(codes.bits().get(begin,end));
+			pp.absent.push_back(absent.bits().get(begin,end));
+			pp.bits.push_back(end-begin);
+
+		}
+
+		for(uint i=0;i<symbols_per_word;i++)
+			pp.low_bits |= ((ulint)1)<<(i*log_sigma);
+
+		return pp;
+
+	}
+
+	//number of mismatches between the packed pattern and the text at position s. Stops as soon as max_errors is exceeded
+	inline ulint mismatches(packed_pattern &pp, ulint s, uint max_errors){
+
+		ulint dist=0;
+		ulint offset = s*log_sigma;
+
+		for(ulint c=0;c<pp.words.size() and dist<=max_errors;c++){
+
+			ulint x = (text_wv.bits().get(offset,offset+pp.bits[c]) ^ pp.words[c]) | pp.absent[c];
+
+			//OR the bits of each field into its lowest bit, then count the fields that differ
+			ulint y = x;
+			for(uint t=1;t<log_sigma;t++)
+				y |= x>>t;
+
+			dist += popcnt(y & pp.low_bits);
+			offset += pp.bits[c];
+
+		}
+
+		return dist;
+
+	}
+
+	//interval = rows prefixed by a word of w-digits_left digits. Adds to stats the loads of its extensions to w digits
+	void refineLoad(pair<ulint, ulint> interval, uint digits_left, vector<ulint> &stats, ulint &occurring){
+
+		if(digits_left==0){
+
+			ulint occ = interval.second-interval.first;
+
+			stats[std::min(occ,(ulint)stats.size()-1)]++;
+			occurring++;
+
+			return;
+
+		}
+
+		for(ulint c=0;c<h.base;c++){
+
+			pair<ulint, ulint> extended = indexedBWT.BS(c,1,interval);
+
+			if(extended.second>extended.first)
+				refineLoad(extended, digits_left-1, stats, occurring);
+
+		}
+
+	}
+
+	//BWT interval of the fingerprints whose suffix of length w_aux is 'suffix'
+	pair<ulint, ulint> auxHashInterval(ulint suffix){
+
+		pair<ulint, ulint> interval;
+
+		interval.first = auxiliary_hash[suffix];
+
+		if (suffix + 1 == auxiliary_hash_size)
+			interval.second = text_fingerprint_length + 1;
+		else
+			interval.second = auxiliary_hash[suffix+1];
+
+		return interval;
+
+	}
+
+	//builds the structure streaming the text from fr (a FileReader or a SequenceFileReader). Temporary files are created next to input
+	template<typename reader>
+	void build(reader &fr, string &input, HashFunction &h, ulint offrate, bool verbose){
+
+		ulint text_length = fr.size();
+
+		if(text_length<h.m){
+			cout << "Error: text length " << text_length << " is smaller than the pattern length " << h.m << endl;
+			exit(1);
+		}
+
+		init(text_length,h,offrate,verbose);
+
+		string fingerprint_path = input + ".fp.tmp";
+		string bwt_path = input + ".bwt.tmp";
+
+		if(verbose)	cout << " Computing hash value h(T) of the text ..." << flush;
+		h.hashValueRemappedToFile(fr,fingerprint_path);
+		if(verbose)	cout << " Done.\n";
+
+		if(verbose)	cout << " Computing BWT(h(T))  ..." <<flush;
+		bwt_builder::toFile(fingerprint_path,cw_bwt::path,bwt_path,verbose,bwt_builder::compressed);
+		if(verbose)	cout << " Done.\n";
+
+		remove(fingerprint_path.c_str());
+
+		{
+
+			FileReader bwt_reader(bwt_path);
+			indexedBWT =  IndexedBWT(bwt_reader,offrate,verbose);
+			bwt_reader.close();
+
+		}
+
+		remove(bwt_path.c_str());
+
+		if(verbose)	cout << " Storing text T in plain format ...";
+		initText([&](ulint i, uchar * buf, ulint len){
+
+			if(i==0)
+				fr.rewind();
+
+			fr.read(buf,len);
+
+		});
+		if(verbose)	cout << " Done.\n";
+
+		if(verbose)	cout << "\n  Building auxiliary hash ... " << endl;
+		initAuxHash();
+		if(verbose)	cout << "  Done. " << endl;
+
+		if(verbose)	cout << "\nDone. Size of the structure = " << (double)size()/(n*8) << "n Bytes" <<endl;
+
+	}
+
+	//parameters of the structure for a text of length n
+	void init(ulint n, HashFunction &h, ulint offrate, bool verbose){
+
+		this->n = n;
+		this->h = h;
+		this->offrate = offrate;
+
+		m = h.m;
+		w = h.w;
+
+		text_fingerprint_length = n-m+w;
+
+		if(verbose) cout << " Text fingerprint length = " << text_fingerprint_length<<endl;
+
+		w_aux = ceil( ( log2(n) - log2(log2(n)) )/log2(h.base) );//log_b n - log_b log_2 n
+
+		if(w_aux>w) w_aux=w;
+
+		auxiliary_hash_size = 1 << (w_aux * h.log_base);
+
+		if(verbose)	cout << " w = " << w <<endl;
+		if(verbose)	cout << " w_aux = " << w_aux <<endl;
+
+	}
+
+	/*
+	 * stores the text in packed form. read_block(i,buf,len) copies T[i,...,i+len-1] in buf: the text is read
+	 * sequentially (in blocks) twice, to detect the alphabet and to pack it.
+	 */
+	template<typename block_reader>
+	void initText(block_reader read_block){
 
 		char_to_int = vector<uint>(256);
 
@@ -384,12 +888,22 @@ protected:
 
 		sigma=0;
 
+		const ulint block_size = 1<<20;
+		vector<uchar> block(block_size);
+
 		//compute alphabet size and init codes to convert char to int
-		for(ulint i = 0;i<n;i++){
+		for(ulint b=0;b<n;b+=block_size){
+
+			ulint len = std::min(block_size,n-b);
+			read_block(b,block.data(),len);
+
+			for(ulint i = 0;i<len;i++){
+
+				if(char_to_int[block[i]]==empty){
+					char_to_int[block[i]] = sigma;
+					sigma++;
+				}
 
-			if(char_to_int[(uchar)text.at(i)]==empty){
-				char_to_int[(uchar)text.at(i)] = sigma;
-				sigma++;
 			}
 
 		}
@@ -408,30 +922,74 @@ protected:
 
 		text_wv =  packed_view_t(log_sigma,n);
 
-		for(ulint i = 0;i<n;i++)
-			text_wv[i] = char_to_int[(uchar)text.at(i)];
+		for(ulint b=0;b<n;b+=block_size){
+
+			ulint len = std::min(block_size,n-b);
+			read_block(b,block.data(),len);
+
+			for(ulint i = 0;i<len;i++)
+				text_wv[b+i] = char_to_int[block[i]];
+
+		}
 
 	}
 
+	/*
+	 * auxiliary_hash[i] = first BWT row prefixed by i (seen as a string of w_aux digits). If no row is prefixed by i, the first row
+	 * prefixed by the next word j>i that occurs (text_fingerprint_length if there is none).
+	 * Computed in O(n) time by counting, without backward searches: h(T) is recomputed block by block from the packed text
+	 * (in parallel), and a rolling window reads the w_aux digits that follow each text position. Rows whose suffix is shorter than
+	 * w_aux (terminator included) precede all their extensions.
+	 */
 	void initAuxHash(){
 
 		auxiliary_hash =  packed_view_t(ceil(log2(n+1)),auxiliary_hash_size);
 
-		ulint empty = text_fingerprint_length+1;
+		//first, auxiliary_hash[i] = number of rows with prefix < i and >= i-1
+		for (ulint i = 0; i < auxiliary_hash_size; i++)
+			auxiliary_hash[i] = 0;
+
+		ulint log_base = h.log_base;
+		ulint mask = auxiliary_hash_size-1;
+
+		const ulint block_size = 1<<22;
+		vector<uchar> chars;
+		vector<uchar> digits(block_size);
+
+		ulint V = 0;//last w_aux digits read
+		vector<bool> occurs(auxiliary_hash_size,false);//words of w_aux digits that prefix some row
 
 		int perc,last_perc=-1;
 
-		for (ulint i = 0; i < auxiliary_hash_size; i++){
+		for(ulint b=0;b<text_fingerprint_length;b+=block_size){
+
+			ulint e = std::min(b+block_size,text_fingerprint_length);
+
+			//digits [b,e) depend on the characters [b,e+m-w)
+			chars.resize(e+m-w-b);
+			for(ulint i=b;i<e+m-w;i++)
+				chars[i-b] = textAt(i);
+
+			h.remappedDigits(chars.data(), digits.data(), b, e, b, 0);
+
+			for(ulint i=b;i<e;i++){
 
-			pair<ulint,ulint> interval = indexedBWT.BS(i,w_aux);
+				V = ((V<<log_base) | (digits[i-b]-1)) & mask;
 
-			if(interval.second>interval.first)
-				auxiliary_hash[i] = interval.first;
-			else
-				auxiliary_hash[i] = empty;
+				//the suffix starting at i-w_aux+1 has prefix V
+				if(i+1>=w_aux){
+
+					occurs[V] = true;
+
+					if(V+1<auxiliary_hash_size)
+						auxiliary_hash[V+1] = auxiliary_hash.get(V+1)+1;
+
+				}
+
+			}
 
-			perc = (100*i)/auxiliary_hash_size;
-			if(perc>last_perc and perc%10==0){
+			perc = (100*e)/text_fingerprint_length;
+			if(perc>last_perc){
 
 				cout << "   " <<  perc << "% done." << endl;
 				last_perc=perc;
@@ -440,12 +998,31 @@ protected:
 
 		}
 
-		if (auxiliary_hash[auxiliary_hash_size-1] == empty)
+		//the last suffixes (L<w_aux digits followed by the terminator) precede all the words having their L digits as prefix
+		for(ulint L=0;L<w_aux and L<=text_fingerprint_length;L++){
+
+			ulint prefix = (V & ((((ulint)1)<<(log_base*L))-1)) << (log_base*(w_aux-L));
+			auxiliary_hash[prefix] = auxiliary_hash.get(prefix)+1;
+
+		}
+
+		//prefix sums: number of rows with prefix smaller than i
+		ulint rows = 0;
+
+		for (ulint i = 0; i < auxiliary_hash_size; i++) {
+
+			rows += auxiliary_hash.get(i);
+			auxiliary_hash[i] = rows;
+
+		}
+
+		//words that do not occur point to the next word that occurs
+		if (not occurs[auxiliary_hash_size-1])
 			auxiliary_hash[auxiliary_hash_size-1] = text_fingerprint_length;
 
 		for (ulint i = auxiliary_hash_size - 1; i >= 1; i--) {
 
-			if (auxiliary_hash[i-1] == empty)
+			if (not occurs[i-1])
 				auxiliary_hash[i-1] = auxiliary_hash.get(i);
 
 		}
@@ -472,6 +1049,8 @@ protected:
 	vector<uint> char_to_int;//conversion from a char in the text to an integer in the range {0,...,sigma-1}
 	vector<uchar> int_to_char;//conversion from int in the range {0,...,sigma-1} to a char
 
+	std::shared_ptr<OccurrenceCache> cache;//fingerprint lookups cache (not saved to file)
+
 };
 
 } /* namespace data_structures */
@@ -37,6 +37,7 @@
 #include "../common/common.h"
 #include "DynamicString.h"
 #include "dynamic_vector.h"
+#include "packed_dynamic_vector.h"
 
 namespace bwtil {
 
@@ -79,6 +80,7 @@ public:
 			number_of_samples = n/sample_rate + (n%sample_rate>0) + 1;//first text position always sampled
 			sampled_positions = dynamic_bitvector_type(n);
 			sa_samples = dynamic_vector_type(number_of_samples,number_of_bits(n));
+			sample_mask = (ulint(1)<<number_of_bits(n))-1;
 
 			//position containing terminator is sampled.
 			sampled_positions.insert(0,true);
@@ -158,16 +160,16 @@ public:
 		//update samples
 		if(sample_rate>0){
 
-			//check if this position has to be sampled
+			//check if this position has to be sampled (positions are counted including the removed characters)
 			//first text position is always sampled
-			bool sampled = ((current_size%sample_rate)==0) or current_size==n-1;
+			bool sampled = (((current_size+removed)%sample_rate)==0) or (removed==0 and current_size==n-1);
 
 			//always update bitvector
 			sampled_positions.insert(terminator_pos,sampled);
 
 			//update dynamic vector only if the position is sampled
 			if(sampled)
-				sa_samples.insert( sampled_positions.rank(terminator_pos,true), current_size );
+				sa_samples.insert( sampled_positions.rank(terminator_pos,true), (current_size+removed) & sample_mask );
 
 		}
 
@@ -184,13 +186,14 @@ public:
 
 		assert(i<current_size);
 
-		symbol s = access(i);
-
-		//if the symbol is terminato, then on F column position is 0
-		if(s==sigma)
+		//if the symbol is terminator, then on F column position is 0
+		if(i==terminator_pos)
 			return 0;
 
-		return F[ s ] + rank(s,i);
+		//symbol and its rank with one traversal of the wavelet tree
+		auto sr = ds.inverse_select(i<terminator_pos ? i : i-1);
+
+		return F[ sr.first ] + sr.second;
 
 	}
 
@@ -209,7 +212,7 @@ public:
 			return 0;
 
 		if(sampled_positions[i])
-			return current_size - sa_samples[sampled_positions.rank(i,true)] -1;
+			return current_size - ((sa_samples[sampled_positions.rank(i,true)] - removed) & sample_mask) -1;
 
 		return locate(LF(i))+1;
 
@@ -230,16 +233,259 @@ public:
 			return current_size-1;
 
 		if(sampled_positions[i])
-			return sa_samples[sampled_positions.rank(i,true)];
+			return (sa_samples[sampled_positions.rank(i,true)] - removed) & sample_mask;
 
 		return locate_right(LF(i)) - 1 ;
 
 	}
 
+	/*
+	 * remove the last character of the text, i.e. the first character inserted with extend (sliding window: the BWT is
+	 * left-extended with the new characters and the oldest ones are removed from the right end).
+	 *
+	 * The row of the suffix c$ (c being the removed character) is deleted and c is replaced by its preceding character in
+	 * the row of $. The suffixes ending with c may now be misplaced: they are moved to their new rank, from the shortest one,
+	 * until the first one which is already in place (Salson et al., "A four-stage algorithm for updating a Burrows-Wheeler
+	 * transform", TCS 2009). The number of moved rows is at most the length of the longest repeat ending at the text end.
+	 *
+	 * Requires dynamic_bitvector_type and dynamic_vector_type with remove (packed_dynamic_bitvector, packed_dynamic_vector).
+	 */
+	void remove_last(){
+
+		assert(current_size>1);
+
+		//row of the suffix c$ (BWT[0]=c since row 0 is the suffix $)
+		ulint r = LF(0);
+
+		//row of the suffix preceding c$: the first one that might be misplaced
+		ulint cur = LF(r);
+
+		bwt_row last = removeRow(r);
+
+		if(cur>r)
+			cur--;
+
+		removed++;
+
+		//the character preceding $ is now the one that preceded c$. $ is always sampled, at text position 0
+		bwt_row first = removeRow(0);
+		first.c = last.c;
+		first.sample = removed & sample_mask;
+		insertRow(0,first);
+
+		//the text is now empty
+		if(last.c==sigma)
+			return;
+
+		//expected row of the suffix in row cur
+		ulint exp = LF(0);
+
+		while(cur!=exp){
+
+			//row of the next suffix to check (LF computed before moving row cur)
+			ulint next = LF(cur);
+
+			insertRow(exp, removeRow(cur));
+
+			cur = next;
+			exp = LF(exp);
+
+		}
+
+	}
+
 	ulint getMaxLength(){ return n; }
 
+	/*
+	 * save/load the dynamic BWT (dynamic string, F, terminator position and SA sampling): an index built incrementally can be
+	 * persisted and extended later. Requires dynamic_bitvector_type and dynamic_vector_type with saveToFile/loadFromFile
+	 * (packed_dynamic_bitvector, packed_dynamic_vector).
+	 */
+	void saveToFile(string path){
+
+		FILE *fp;
+
+		if ((fp = fopen(path.c_str(), "wb")) == NULL) {
+			cout << "Cannot open file " << path << endl;
+			exit(1);
+		}
+
+		saveToFile(fp);
+
+		fclose(fp);
+
+	}
+
+	void load(string path){
+
+		FILE *fp;
+
+		if ((fp = fopen(path.c_str(), "rb")) == NULL) {
+			cout << "Cannot open file " << path << endl;
+			exit(1);
+		}
+
+		loadFromFile(fp);
+
+		fclose(fp);
+
+	}
+
+	void saveToFile(FILE *fp){
+
+		fwrite(&n, sizeof(ulint), 1, fp);
+		fwrite(&terminator_pos, sizeof(ulint), 1, fp);
+		fwrite(&current_size, sizeof(ulint), 1, fp);
+		fwrite(&sigma, sizeof(ulint), 1, fp);
+		fwrite(F.data(), sizeof(ulint), sigma, fp);
+		fwrite(&sample_rate, sizeof(ulint), 1, fp);
+		fwrite(&number_of_samples, sizeof(ulint), 1, fp);
+		fwrite(&sample_mask, sizeof(ulint), 1, fp);
+		fwrite(&removed, sizeof(ulint), 1, fp);
+
+		ds.saveToFile(fp);
+
+		if(sample_rate>0){
+
+			sampled_positions.saveToFile(fp);
+			sa_samples.saveToFile(fp);
+
+		}
+
+	}
+
+	void loadFromFile(FILE *fp){
+
+		ulint numBytes;
+
+		numBytes = fread(&n, sizeof(ulint), 1, fp);
+		assert(numBytes>0);
+		numBytes = fread(&terminator_pos, sizeof(ulint), 1, fp);
+		assert(numBytes>0);
+		numBytes = fread(&current_size, sizeof(ulint), 1, fp);
+		assert(numBytes>0);
+		numBytes = fread(&sigma, sizeof(ulint), 1, fp);
+		assert(numBytes>0);
+
+		F = vector<ulint>(sigma);
+
+		if(sigma>0){
+
+			numBytes = fread(F.data(), sizeof(ulint), sigma, fp);
+			assert(numBytes>0);
+
+		}
+
+		numBytes = fread(&sample_rate, sizeof(ulint), 1, fp);
+		assert(numBytes>0);
+		numBytes = fread(&number_of_samples, sizeof(ulint), 1, fp);
+		assert(numBytes>0);
+		numBytes = fread(&sample_mask, sizeof(ulint), 1, fp);
+		assert(numBytes>0);
+		numBytes = fread(&removed, sizeof(ulint), 1, fp);
+		assert(numBytes>0);
+
+		ds = DynamicString<dynamic_bitvector_type>();
+		ds.loadFromFile(fp);
+
+		if(sample_rate>0){
+
+			sampled_positions.loadFromFile(fp);
+			sa_samples.loadFromFile(fp);
+
+		}
+
+		numBytes++;//avoids "variable not used" warning
+
+	}
+
 private:
 
+	//a row of the BWT: its character and sampling information
+	struct bwt_row{
+
+		symbol c;
+		bool sampled;
+		ulint sample;
+
+	};
+
+	//remove row i of the BWT and return it
+	bwt_row removeRow(ulint i){
+
+		bwt_row r = {(symbol)sigma, false, 0};
+
+		if(i==terminator_pos){
+
+			terminator_pos = n;//undefined until the row is inserted back
+
+		}else{
+
+			r.c = ds.remove(i<terminator_pos ? i : i-1);
+
+			if(i<terminator_pos)
+				terminator_pos--;
+
+			for(ulint s=r.c+1;s<sigma;s++)
+				F[s]--;
+
+		}
+
+		if(sample_rate>0){
+
+			r.sampled = sampled_positions[i];
+
+			if(r.sampled)
+				r.sample = sa_samples.remove(sampled_positions.rank(i,true));
+
+			sampled_positions.remove(i);
+
+		}
+
+		current_size--;
+
+		return r;
+
+	}
+
+	//insert row r in position i of the BWT
+	void insertRow(ulint i, bwt_row r){
+
+		if(r.c==sigma){
+
+			terminator_pos = i;
+
+		}else{
+
+			if(i<=terminator_pos){
+
+				ds.insert(r.c,i);
+				terminator_pos++;
+
+			}else{
+
+				ds.insert(r.c,i-1);
+
+			}
+
+			for(ulint s=r.c+1;s<sigma;s++)
+				F[s]++;
+
+		}
+
+		if(sample_rate>0){
+
+			sampled_positions.insert(i,r.sampled);
+
+			if(r.sampled)
+				sa_samples.insert(sampled_positions.rank(i,true),r.sample);
+
+		}
+
+		current_size++;
+
+	}
+
 	DynamicString<dynamic_bitvector_type> ds;
 	ulint n=0;//length of ds + 1 (terminator)
 	ulint terminator_pos=0;
@@ -254,10 +500,13 @@ private:
 	ulint number_of_samples=0;
 	dynamic_bitvector_type sampled_positions;//mark with a 1 sampled positions
 	dynamic_vector_type sa_samples;//sampled SA pointers. Note: positions start from the end of the text, with last character having position 1 and terminator having position 0
+	ulint sample_mask=0;//samples are stored modulo 2^(bits of n), shifted by the number of removed characters
+
+	ulint removed=0;//number of characters removed with remove_last
 
 };
 
-typedef DynamicBWT<bitv,dynamic_vector_t> dynamic_bwt_t;
+typedef DynamicBWT<bitv,packed_dynamic_vector_t> dynamic_bwt_t;
 
 } /* namespace bwtil */
 #endif /* DYNAMICBWT_H_ */
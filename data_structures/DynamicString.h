@@ -29,6 +29,7 @@
 #include "DummyDynamicBitvector.h"
 
 #include <sstream>
+#include <type_traits>
 
 namespace bwtil {
 
@@ -59,8 +60,7 @@ public:
 		if(unary_string)
 			return i;
 
-		vector<bool> code = codes.at(x);//bitvector to be searched in the wavelet tree
-		return rank(&code, 0, 0, i);
+		return rank(codes.at(x), 0, 0, i);//code is searched in the wavelet tree
 
 	}
 
@@ -108,14 +108,10 @@ public:
 			cout << "ERROR (DynamicString): Maximum size of the alphabet is 255. (input alphabet size is " << freq.size() << ")\n";
 			exit(0);
 		}
-
-		this->freq = vector<ulint>(freq.size());
-
-		for(ulint i=0;i<freq.size();i++)
-			this->freq.at(i) = freq.at(i);
-
 	#endif
 
+		this->freq = freq;
+
 		sigma = freq.size();
 		sigma_0=0;
 
@@ -128,12 +124,10 @@ public:
 			cout << "ERROR (DynamicString): trying to build dynamic string on a null alphabet\n";
 			exit(0);
 		}
-
-		current_freqs = vector<ulint>(freq.size());
-		for(uint i=0;i<freq.size();i++)
-			current_freqs.at(i)=0;
 	#endif
 
+		current_freqs = vector<ulint>(freq.size(),0);
+
 		current_size = 0;
 
 		if(sigma_0==1){
@@ -198,6 +192,32 @@ public:
 
 	}
 
+	/*
+	 * returns the pair <s,r>, where s=access(i) and r=rank(s,i), with a single descent of the wavelet tree
+	 * (the rank computed at each level to follow the path of s is exactly the rank of s at the next level). If the bitvector
+	 * has access_rank, each level costs one bitvector descent; otherwise two (access and rank)
+	 */
+	pair<symbol, ulint> inverse_select(ulint i){
+
+		if(n==0)
+			return {0,0};
+
+	#ifdef DEBUG
+		if(i>=current_size){
+
+			cout << "ERROR (DynamicString): trying to access position outside current string : " << i << ">=" << current_size << endl;
+			exit(0);
+
+		}
+	#endif
+
+		if(unary_string)
+			return {s,i};
+
+		return inverse_select(0,i);
+
+	}
+
 	void insert(symbol x, ulint i){
 
 		if(n==0)
@@ -217,16 +237,13 @@ public:
 			exit(0);
 
 		}
-
-		current_freqs.at(x) += 1;
-
 	#endif
 
+		current_freqs[x]++;
 
 		if(not unary_string){
 
-			vector<bool> code = codes.at(x);//bitvector to be inserted in the wavelet tree
-			insert(&code,0,0,i);
+			insert(codes.at(x),0,0,i);//code is inserted in the wavelet tree
 
 		}
 
@@ -234,6 +251,151 @@ public:
 
 	}
 
+	/*
+	 * remove the symbol in position i. Returns the removed symbol.
+	 * Requires a dynamic_bitvector_type with remove (e.g. packed_dynamic_bitvector).
+	 */
+	symbol remove(ulint i){
+
+		if(n==0)
+			return 0;
+
+	#ifdef DEBUG
+		if(i>=current_size){
+
+			cout << "ERROR (DynamicString): trying to remove position outside current string : " << i << ">=" << current_size << endl;
+			exit(0);
+
+		}
+	#endif
+
+		symbol x = (unary_string ? s : remove(0,i));
+
+		current_freqs[x]--;
+
+		current_size--;
+
+		return x;
+
+	}
+
+	/*
+	 * save/load the string (Huffman codes, tree topology and the bitvectors of the wavelet tree).
+	 * Requires a dynamic_bitvector_type with saveToFile/loadFromFile (e.g. packed_dynamic_bitvector).
+	 */
+	void saveToFile(FILE *fp){
+
+		fwrite(&n, sizeof(ulint), 1, fp);
+		fwrite(&current_size, sizeof(ulint), 1, fp);
+		fwrite(&unary_string, sizeof(bool), 1, fp);
+		fwrite(&H0, sizeof(double), 1, fp);
+		fwrite(&sigma, sizeof(symbol), 1, fp);
+		fwrite(&sigma_0, sizeof(symbol), 1, fp);
+		fwrite(&s, sizeof(symbol), 1, fp);
+
+		saveVector(freq,fp);
+		saveVector(current_freqs,fp);
+
+		if(n==0 or unary_string)
+			return;
+
+		fwrite(&number_of_internal_nodes, sizeof(symbol), 1, fp);
+		fwrite(child0.data(), sizeof(uint16_t), number_of_internal_nodes, fp);
+		fwrite(child1.data(), sizeof(uint16_t), number_of_internal_nodes, fp);
+
+		ulint number_of_codes = codes.size();
+		fwrite(&number_of_codes, sizeof(ulint), 1, fp);
+
+		for(auto &code : codes){
+
+			ulint length = code.size();
+			fwrite(&length, sizeof(ulint), 1, fp);
+
+			for(bool b : code){
+
+				uchar x = b;
+				fwrite(&x, sizeof(uchar), 1, fp);
+
+			}
+
+		}
+
+		for(uint i=0;i<number_of_internal_nodes;i++)
+			wavelet_tree[i].saveToFile(fp);
+
+	}
+
+	void loadFromFile(FILE *fp){
+
+		ulint numBytes;
+
+		numBytes = fread(&n, sizeof(ulint), 1, fp);
+		assert(numBytes>0);
+		numBytes = fread(&current_size, sizeof(ulint), 1, fp);
+		assert(numBytes>0);
+		numBytes = fread(&unary_string, sizeof(bool), 1, fp);
+		assert(numBytes>0);
+		numBytes = fread(&H0, sizeof(double), 1, fp);
+		assert(numBytes>0);
+		numBytes = fread(&sigma, sizeof(symbol), 1, fp);
+		assert(numBytes>0);
+		numBytes = fread(&sigma_0, sizeof(symbol), 1, fp);
+		assert(numBytes>0);
+		numBytes = fread(&s, sizeof(symbol), 1, fp);
+		assert(numBytes>0);
+
+		freq = loadVector(fp);
+		current_freqs = loadVector(fp);
+
+		if(n==0 or unary_string)
+			return;
+
+		numBytes = fread(&number_of_internal_nodes, sizeof(symbol), 1, fp);
+		assert(numBytes>0);
+
+		child0 = vector<uint16_t>(number_of_internal_nodes);
+		child1 = vector<uint16_t>(number_of_internal_nodes);
+
+		numBytes = fread(child0.data(), sizeof(uint16_t), number_of_internal_nodes, fp);
+		assert(numBytes>0);
+		numBytes = fread(child1.data(), sizeof(uint16_t), number_of_internal_nodes, fp);
+		assert(numBytes>0);
+
+		ulint number_of_codes;
+		numBytes = fread(&number_of_codes, sizeof(ulint), 1, fp);
+		assert(numBytes>0);
+
+		codes = vector<vector<bool> >(number_of_codes);
+
+		for(auto &code : codes){
+
+			ulint length;
+			numBytes = fread(&length, sizeof(ulint), 1, fp);
+			assert(numBytes>0);
+
+			code = vector<bool>(length);
+
+			for(ulint j=0;j<length;j++){
+
+				uchar x;
+				numBytes = fread(&x, sizeof(uchar), 1, fp);
+				assert(numBytes>0);
+
+				code[j] = x;
+
+			}
+
+		}
+
+		wavelet_tree = vector<bitvector_type>(number_of_internal_nodes);
+
+		for(uint i=0;i<number_of_internal_nodes;i++)
+			wavelet_tree[i].loadFromFile(fp);
+
+		numBytes++;//avoids "variable not used" warning
+
+	}
+
 	string toString(){
 
 		stringstream ss;
@@ -277,6 +439,35 @@ public:
 
 private:
 
+	static void saveVector(vector<ulint> &v, FILE *fp){
+
+		ulint size = v.size();
+		fwrite(&size, sizeof(ulint), 1, fp);
+		fwrite(v.data(), sizeof(ulint), size, fp);
+
+	}
+
+	static vector<ulint> loadVector(FILE *fp){
+
+		ulint size;
+		ulint numBytes = fread(&size, sizeof(ulint), 1, fp);
+		assert(numBytes>0);
+
+		vector<ulint> v(size);
+
+		if(size>0){
+
+			numBytes = fread(v.data(), sizeof(ulint), size, fp);
+			assert(numBytes>0);
+
+		}
+
+		numBytes++;//avoids "variable not used" warning
+
+		return v;
+
+	}
+
 	void buildTree(vector<ulint> freq,vector<symbol> alphabet,uint pos,uint this_node, uint * next_free_node){
 
 		vector<symbol> alphabet0;
@@ -341,15 +532,15 @@ private:
 
 	}
 
-	inline void insert(vector<bool> * code, uint node, uint pos, ulint i){
+	inline void insert(const vector<bool> &code, uint node, uint pos, ulint i){
 
-		bool bit = code->at(pos);
+		bool bit = code[pos];
 
 		//cout << "insert of " << bit << " in position " << i << "of bitv of size " << wavelet_tree[node].info().capacity << endl;
 
 		wavelet_tree[node].insert( i, bit );
 
-		if(pos+1<code->size()){
+		if(pos+1<code.size()){
 
 			uint next_node = (bit==0?child0[node]:child1[node]);//find next node
 
@@ -379,13 +570,67 @@ private:
 
 		}
 
-	inline ulint rank(vector<bool> * code, uint node, uint pos, ulint i){
+	inline symbol remove(uint node, ulint i){
+
+		bool bit = wavelet_tree[node].access(i);
+		ulint next_i = wavelet_tree[node].rank(i,bit);
+
+		wavelet_tree[node].remove(i);
+
+		uint next_node = (bit==0?child0[node]:child1[node]);
+
+		if(next_node>=sigma)//next node is leaf:return symbol
+			return next_node-sigma;
+
+		return remove(next_node, next_i);
+
+	}
+
+	inline pair<symbol, ulint> inverse_select(uint node, ulint i){
+
+		auto br = access_rank(wavelet_tree[node], i, std::integral_constant<bool,has_access_rank<bitvector_type>::value>());
+
+		bool bit = br.first;
+		ulint next_i = br.second;
+
+		uint next_node = (bit==0?child0[node]:child1[node]);
+
+		if(next_node>=sigma)//next node is leaf: next_i is the rank of the symbol
+			return {next_node-sigma, next_i};
 
-		bool bit = code->at(pos);
+		return inverse_select(next_node, next_i);
+
+	}
+
+	//true if bitvector T has a member access_rank (access and rank with one descent, e.g. packed_dynamic_bitvector)
+	template<class T>
+	struct has_access_rank{
+
+		template<class U> static char test(decltype(&U::access_rank));
+		template<class U> static long test(...);
+
+		static const bool value = sizeof(test<T>(0))==1;
+
+	};
+
+	//bit in position i of b and its rank
+	static inline pair<bool,ulint> access_rank(bitvector_type &b, ulint i, std::true_type){return b.access_rank(i);}
+
+	static inline pair<bool,ulint> access_rank(bitvector_type &b, ulint i, std::false_type){
+
+		bool bit = b.access(i);
+
+		return {bit, b.rank(i,bit)};
+
+	}
+
+	inline ulint rank(const vector<bool> &code, uint node, uint pos, ulint i){
+
+		bool bit = code[pos];
 		//ulint bit_rank = wavelet_tree[node].rank(bit,i);
 		ulint bit_rank = wavelet_tree[node].rank(i,bit);
 
-		if(pos+1==code->size())
+		if(pos+1==code.size())
 			return bit_rank;
 
 		uint next_node = (bit==0?child0[node]:child1[node]);//find next node
@@ -394,12 +639,8 @@ private:
 
 	}
 
-#ifdef DEBUG
-
-	vector<ulint> freq;//debug only: absolute frequencies of the symbols
-	vector<ulint> current_freqs;//debug only: number of symbols inserted
-
-#endif
+	vector<ulint> freq;//absolute frequencies of the symbols (maximum number of occurrences)
+	vector<ulint> current_freqs;//number of occurrences of each symbol in the current string
 
 	symbol number_of_internal_nodes;
 	symbol sigma;//alphabet size
@@ -68,8 +68,8 @@ public:
 
 	void read(uchar * buf, ulint n){
 
-		for(ulint i=0;i<n;i++)
-			buf[i] = get();
+		fs->read((char *)buf,n);
+		pos+=n;
 
 	}
 
@@ -25,8 +25,11 @@
 #define HASHFUNCTION_H_
 
 #include "../common/common.h"
+#include "FileReader.h"
+#include "SequenceFileReader.h"
 #include <sstream>
 #include <fstream>
+#include <thread>
 
 namespace bwtil {
 
@@ -138,7 +141,8 @@ public:
 
 	HashFunction(){}
 
-	HashFunction(ulint m, string file_path, bool verbose = false){
+	//mode = file_path (raw text file) or sequence_file_path (sequences of a FASTA/FASTQ/2-bit file)
+	HashFunction(ulint m, string file_path, bool verbose = false, input_mode mode = input_mode::file_path){
 
 		if(verbose)	cout << "\nBuilding hash function ... \n";
 
@@ -152,13 +156,10 @@ public:
 
 		if(verbose)	cout << " Reading input file for detecting alphabet size and file length ... \n";
 
-		unsigned char ch;
-		fstream fin(file_path, fstream::in);
-
 		vector<uchar> alphabet;
 		vector<bool> char_inserted = vector<bool>(256,false);
 
-		while (fin >> noskipws >> ch) {
+		auto insert = [&](uchar ch){
 
 			if(not char_inserted.at(ch)){
 
@@ -167,19 +168,50 @@ public:
 
 			}
 
-			n++;
+		};
+
+		if(mode==sequence_file_path){
+
+			SequenceFileReader fr(file_path);
+			n = fr.size();
+
+			vector<uchar> block(1<<20);
+
+			for(ulint b=0;b<n;b+=block.size()){
+
+				ulint len = std::min((ulint)block.size(),n-b);
+				fr.read(block.data(),len);
+
+				for(ulint i=0;i<len;i++)
+					insert(block[i]);
+
+			}
+
+			fr.close();
+
+		}else{
+
+			unsigned char ch;
+			fstream fin(file_path, fstream::in);
+
+			while (fin >> noskipws >> ch) {
+
+				insert(ch);
+				n++;
+
+			}
+
+			fin.close();
 
 		}
 
 		if(n==0){
 			VERBOSE_CHANNEL<< "Empty file. "  << file_path <<endl;
-			fin.close();
 			exit(1);
 		}
 
 		if(alphabet.size()<=1){
 			VERBOSE_CHANNEL<< "Error: alphabet size (" << alphabet.size() << ") is less than or equal to 1." <<endl;
-			fin.close();
 			exit(1);
 		}
 
@@ -199,8 +231,6 @@ public:
 		for(uint i=0;i<alphabet.size();i++)
 			code[alphabet.at(i)] = i%base;
 
-		fin.close();
-
 		if(verbose)	cout << " File length : n = " << n<<endl;
 
 		if(verbose)	cout << " Pattern length : m = " << m<<endl;
@@ -228,34 +258,50 @@ public:
 
 	ulint hashValue(string &P){//compute fingerprint of pattern P of length m.
 
+		assert(P.size()==m);
+
+		//the type is tested once: the hash loop is specialized at compile time
 		if(type==QUALITY_DNA_SEARCH or type==QUALITY_BS_SEARCH)
-			return qualityHashValue(P);
+			return fingerprint<true>((uchar*)P.data());
 
-		assert(P.size()==m);
+		return fingerprint<false>((uchar*)P.data());
 
-		ulint W = 0;
-		ulint result = 0;
+	}
 
-		for(uint i=0;i<m-r;i++){
+	/*
+	 * fingerprints of all the substrings S[i,...,i+m-1], i=0,...,|S|-m (e.g. all the m-mers of a read).
+	 * Non-quality fingerprints are computed with a rolling formulation: the fingerprint at position i+1 is obtained
+	 * from the one at position i shifting in one digit, which costs O(1) (see digits()).
+	 */
+	vector<ulint> hashValues(string &S){
 
-			if(i%w==0){
-				result = result^W;
-				W = 0;
-			}
+		if(S.length()<m)
+			return vector<ulint>();
+
+		ulint windows = S.length()-m+1;
+		vector<ulint> result(windows);
+
+		if(type==QUALITY_DNA_SEARCH or type==QUALITY_BS_SEARCH){
+
+			for(ulint i=0;i<windows;i++)
+				result[i] = fingerprint<true>((uchar*)S.data()+i);
 
-			W = (W<<log_base) + code[(uchar)P.at(i)];
+			return result;
 
 		}
 
-		result = result^W;
-		W = 0;
+		string d = string(windows+w-1,0);
+		digits<false>((uchar*)S.data(), (uchar*)&d[0], 0, d.length());
 
-		if(r>0){
+		ulint mask = (w*log_base>=64 ? ~((ulint)0) : (((ulint)1)<<(w*log_base))-1);
 
-			for(uint i=m-w;i<m;i++)
-				W = (W<<log_base) + code[(uchar)P.at(i)];
+		ulint W = 0;
+		for(ulint i=0;i<d.length();i++){
 
-			result = result^W;
+			W = ((W<<log_base) | (uchar)d[i]) & mask;
+
+			if(i+1>=w)
+				result[i+1-w] = W;
 
 		}
 
@@ -266,9 +312,10 @@ public:
 	/*
 	 * compute hash value of string P having length >= m
 	 * return hash value where 1 is added to each digit. No 0x0 terminator is appended at the end.
+	 * The text is split in chunks hashed in parallel by 'threads' threads (0 = all hardware threads).
 	 * NB: this function is not yet implemented for QUALITY hash values.
 	 */
-	string hashValueRemapped(string &P){
+	string hashValueRemapped(string &P, uint threads=0){
 
 		if(type==QUALITY_DNA_SEARCH or type==QUALITY_BS_SEARCH){
 			cout << "Error: hash value remapped not yet implemented for quality hash functions." << endl;
@@ -277,88 +324,124 @@ public:
 
 		assert(P.length()>=m);
 
-		ulint n = P.length();
-		ulint length=n-m+w;
-		lint blocks = m/w;
+		ulint length=P.length()-m+w;
 
-		ulint bufsize=m+1;
+		string res = string(length,0);
 
-		lint r = m%w;
+		remappedDigits((uchar*)P.data(), (uchar*)&res[0], 0, length, 0, threads);
 
-		if(r==0){
-			blocks--;
-			r=w;
-		}
+		return res;
+
+	}//hashValueRemapped
 
-		srand(time(NULL));
+	/*
+	 * same as hashValueRemapped, but the text is read from text_path and the hash value is written to out_path.
+	 * The text is streamed in chunks: RAM usage does not depend on the text length.
+	 */
+	void hashValueRemappedToFile(string text_path, string out_path, uint threads=0){
 
-		//there are 'blocks' blocks of length w and a final block of length r (which can be equal to w)
+		FileReader fr(text_path);
+		hashValueRemappedToFile(fr,out_path,threads);
+		fr.close();
 
-		string res = string(length,'e');
+	}
 
-		if(m==w){//identity function
+	//as above, reading the text from the beginning of fr (a FileReader or a SequenceFileReader)
+	template<typename reader>
+	void hashValueRemappedToFile(reader &fr, string out_path, uint threads=0){
 
-			for(ulint i=0;i<length;i++)
-				if(random_char[(uchar)P.at(i)])
-					res[i] = rand()%(base)+1;
-				else
-					res[i] = code[(uchar)P.at(i)]+1;
+		if(type==QUALITY_DNA_SEARCH or type==QUALITY_BS_SEARCH){
+			cout << "Error: hash value remapped not yet implemented for quality hash functions." << endl;
+			exit(0);
+		}
 
-			return res;
+		fr.rewind();
+		ulint n = fr.size();
 
+		if(n<m){
+			cout << "Error: text length " << n << " is smaller than the pattern length " << m << endl;
+			exit(1);
 		}
 
-		vector<unsigned char> buffer(bufsize);
+		FILE *fp;
 
-		//fill buffer with the first m+1 digits
-		for(ulint i=0;i<bufsize;i++){
-			if(random_char[(uchar)P.at(i)])
-				buffer[i] = rand()%(base);
-			else
-				buffer[i] = code[(uchar)P.at(i)];
+		if ((fp = fopen(out_path.c_str(), "wb")) == NULL) {
+			VERBOSE_CHANNEL<< "Cannot open file " << out_path << endl;
+			exit(1);
 		}
 
-		//compute first w digits
-		for(ulint i=0;i<w;i++){
+		ulint length=n-m+w;
+		ulint chunk = ((ulint)1)<<22;//digits computed at each step
 
-			res[i]=0;
-			for(lint j=0;j<blocks;j++)
-				res[i] ^= buffer[(i+j*w)%bufsize];
+		//digits [b,e) depend on the characters [b,e+m-w): consecutive chunks overlap by m-w characters
+		vector<uchar> text;
+		vector<uchar> res(chunk);
+		ulint text_start = 0;//position in the text of text[0]
 
-			res[i] ^= buffer[(i+(blocks-1)*w+r)%bufsize];
+		for(ulint b=0;b<length;b+=chunk){
+
+			ulint e = std::min(b+chunk,length);
+
+			text.erase(text.begin(), text.begin()+(b-text_start));
+			text_start = b;
+
+			ulint old_size = text.size();
+			text.resize(e+m-w-b);
+			fr.read(text.data()+old_size, text.size()-old_size);
+
+			remappedDigits(text.data(), res.data(), b, e, b, threads);
+
+			fwrite(res.data(), sizeof(uchar), e-b, fp);
 
 		}
 
-		//compute the other digits
-		ulint newpos=0;
+		fclose(fp);
+
+	}
+
+	/*
+	 * stores in D[begin-offset,...,end-offset-1] the digits begin,...,end-1 of hashValueRemapped(T), where P[0,...] = T[offset,...]
+	 * must contain the characters T[begin,...,end+m-w-1]. Computed by 'threads' threads (0 = all hardware threads).
+	 */
+	void remappedDigits(uchar * P, uchar * D, ulint begin, ulint end, ulint offset, uint threads){
 
-		for(ulint i=w;i<length;i++){
+		if(threads==0)
+			threads = std::thread::hardware_concurrency();
 
-			res[i] = 	res[i-w] ^
-						buffer[(i-w)%bufsize] ^
-						buffer[((lint)i+(blocks-2)*(lint)w+r)%bufsize] ^
-						buffer[(i+(blocks-1)*w)%bufsize] ^
-						buffer[(i+(blocks-1)*w + r)%bufsize];
+		ulint length = end-begin;
 
-			newpos=i+m-w+1;
+		//chunks shorter than 2^16 digits are not worth a thread
+		threads = std::max((ulint)1,std::min((ulint)threads, length>>16));
 
-			if(newpos<n){
+		auto hash_chunk = [&](uint t){
 
-				if(random_char[(uchar)P.at(newpos)])
-					buffer[newpos%bufsize] = rand()%(base);
-				else
-					buffer[newpos%bufsize] = code[(uchar)P.at(newpos)];
+			ulint b = begin + (length*t)/threads;
+			ulint e = begin + (length*(t+1))/threads;
 
-			}
+			digits<true>(P, D, b, e, offset);
 
-		}
+			for(ulint i=b;i<e;i++)//re-map adding 1 to each digit
+				D[i-offset]++;
 
-		for(ulint i=0;i<length;i++)//re-map adding 1 to each digit
-			res[i]++;
+		};
 
-		return res;
+		if(threads==1){
 
-	}//hashValueRemapped
+			hash_chunk(0);
+
+		}else{
+
+			vector<std::thread> pool;
+
+			for(uint t=0;t<threads;t++)
+				pool.push_back(std::thread(hash_chunk,t));
+
+			for(auto &th : pool)
+				th.join();
+
+		}
+
+	}
 
 	uint digitAt(ulint W, uint i){//i-th digit from right
 
@@ -435,9 +518,12 @@ public:
 
 protected:
 
-	ulint qualityHashValue(string &P){//compute quality fingerprint of pattern P of length m.
-
-		assert(P.size()==m);
+	/*
+	 * fingerprint of P[0,...,m-1]: the m/w blocks of w digits and the last w digits are combined
+	 * with XOR (or with OR for quality hash functions)
+	 */
+	template<bool quality>
+	inline ulint fingerprint(uchar * P){
 
 		ulint W = 0;
 		ulint result = 0;
@@ -445,23 +531,23 @@ protected:
 		for(uint i=0;i<m-r;i++){
 
 			if(i%w==0){
-				result = result|W;
+				result = (quality ? result|W : result^W);
 				W = 0;
 			}
 
-			W = (W<<log_base) + code[(uchar)P.at(i)];
+			W = (W<<log_base) | code[P[i]];
 
 		}
 
-		result = result|W;
+		result = (quality ? result|W : result^W);
 		W = 0;
 
 		if(r>0){
 
 			for(uint i=m-w;i<m;i++)
-				W = (W<<log_base) + code[(uchar)P.at(i)];
+				W = (W<<log_base) | code[P[i]];
 
-			result = result|W;
+			result = (quality ? result|W : result^W);
 
 		}
 
@@ -469,6 +555,77 @@ protected:
 
 	}
 
+	/*
+	 * stores in D[begin,...,end-1] the digits begin,...,end-1 of the (non-quality) hash value of P: the fingerprint of P[i,...,i+m-1]
+	 * is D[i,...,i+w-1]. Let B = number of blocks of length w, and r' = length of the last block (r'=w if m mod w = 0). Then
+	 *
+	 * 		D[i] = P[i] xor P[i+w] xor ... xor P[i+(B-1)w] xor P[i+(B-1)w+r']
+	 *
+	 * The first w digits of the range are computed in O(m/w) time each, the others in O(1) time each from D[i-w].
+	 * Ranges can therefore be computed independently (in parallel).
+	 * If randomize, characters marked in random_char get a pseudo-random digit depending on their position.
+	 * P and D store the text and the digits starting from position offset.
+	 */
+	template<bool randomize>
+	void digits(uchar * P, uchar * D, ulint begin, ulint end, ulint offset=0){
+
+		lint blocks = m/w;
+		lint r = m%w;
+
+		if(r==0){
+			blocks--;
+			r=w;
+		}
+
+		lint last = (blocks-1)*(lint)w + r;//offset of the last block
+
+		for(ulint i=begin;i<end;i++){
+
+			uint d;
+
+			if(i<begin+w or blocks==0){
+
+				d = charDigit<randomize>(P,i+last,offset);
+
+				for(lint j=0;j<blocks;j++)
+					d ^= charDigit<randomize>(P,i+j*w,offset);
+
+			}else{
+
+				d = 	D[i-w-offset] ^
+						charDigit<randomize>(P,i-w,offset) ^
+						charDigit<randomize>(P,i+last-w,offset) ^
+						charDigit<randomize>(P,i+(blocks-1)*w,offset) ^
+						charDigit<randomize>(P,i+last,offset);
+
+			}
+
+			D[i-offset] = d;
+
+		}
+
+	}
+
+	template<bool randomize>
+	inline uint charDigit(uchar * P, ulint i, ulint offset=0){
+
+		if(randomize and random_char[P[i-offset]])
+			return randomDigit(i);
+
+		return code[P[i-offset]];
+
+	}
+
+	//pseudo-random digit of position i: depends only on i, so that text chunks can be hashed independently
+	inline uint randomDigit(ulint i){
+
+		i = (i ^ (i>>31)) * 0x7fb5d329728ea185ULL;
+		i = (i ^ (i>>27)) * 0x81dadef4bc2dd44dULL;
+
+		return (i ^ (i>>33)) % base;
+
+	}
+
 	void buildZSet(){
 
 		/*
@@ -34,6 +34,7 @@
 
 #include "WaveletTree.h"
 #include "succinct_bitvector.h"
+#include "FileReader.h"
 
 namespace bwtil {
 
@@ -47,121 +48,23 @@ public:
 	 */
 	IndexedBWT(string &BWT, ulint sample_rate, bool verbose=false){
 
-		this->n=BWT.length();
-		this->offrate=sample_rate;
-
-		number_of_SA_pointers = (sample_rate==0?0:n/sample_rate + 1);
-
-		if(verbose) cout << " Building indexed BWT data structure" << endl;
-		if(verbose) cout << "  Number of sampled SA pointers = " << number_of_SA_pointers << endl;
-
-		w = ceil(log2(n));
-		if(w<1) w=1;
-
-		ulint nr_of_terminators=0;
-
-		//compute re-mapping to keep alphabet size to a minimum
-		//from text chars -> to integers in {0,...,sigma}. the 0x0 byte is also remapped in 0x0, as the first alphabet character.
-		remapping = vector<uchar>(256,0);
-
-		//detect alphabet
-		vector<uchar> alphabet;
-		vector<bool> char_inserted = vector<bool>(256,false);
-
-		for(ulint i=0;i<n;i++){
-
-			if((uchar)BWT.at(i)==0){//found terminator. Save position
-				terminator_position = i;
-				nr_of_terminators++;
-			}else{
-
-				if(not char_inserted.at((uchar)BWT.at(i))){
-
-					alphabet.push_back((uchar)BWT.at(i));
-					char_inserted.at((uchar)BWT.at(i))=true;
-
-				}
-
-			}
-		}
-
-		if(nr_of_terminators!=1){
-
-			cout << "Error (IndexedBWT.cpp): the bwt contains no o more than one 0x0 bytes\n";
-			exit(1);
-
-		}
-
-		sigma = alphabet.size();
-
-		//sort alphabet
-
-		std::sort(alphabet.begin(),alphabet.end());
-
-		//calculate remapping
-		//note: remapping of terminator (0x0) is 0
-
-		for(uint i=0;i<alphabet.size();i++)
-			remapping[alphabet.at(i)] = i;
-
-		//calculate inverse remapping
-
-		inverse_remapping = vector<uchar>(sigma);
-
-		for(uint i=0;i<sigma;i++)
-			inverse_remapping[i] = alphabet.at(i);
-
-		//apply remapping
-
-		for(ulint i=0;i<n;i++)
-			BWT.at(i) = remapping[(uchar)BWT.at(i)];
-
-		bwt_wt =  WaveletTree(BWT,verbose);
+		build(BWT.length(), [&](ulint i, uchar * buf, ulint len){ memcpy(buf, BWT.data()+i, len); }, sample_rate, verbose);
 
-		marked_positions =  succinct_bitvector();
-
-		text_pointers =  packed_view_t(w,number_of_SA_pointers);
-
-		log_sigma = bwt_wt.bitsPerSymbol();
-
-		FIRST = vector<ulint>(256,0);
-
-		FIRST[TERMINATOR]=0;//first occurrence of terminator char in the first column is at the beginning
-
-		//count number of occurrences of each character
-		for(ulint i=0;i<n;i++)
-			if(i!=terminator_position)
-				FIRST[bwt_wt.charAt(i)]++;
-
-		for(uint i=1;i<255;i++)
-			FIRST[i] += FIRST[i-1];
-
-		for(int i=254;i>0;i--)
-			FIRST[i] = FIRST[i-1];
-
-		FIRST[0] = 0;
-
-		for(uint i=0;i<255;i++)
-			FIRST[i]++;
+	}
 
-		//restore original values in BWT
-		for(ulint i=0;i<n;i++)
-			BWT.at(i) = inverse_remapping[(uchar)BWT.at(i)];
+	/*
+	 * constructor: the BWT (terminator character = 0) is streamed from file. The BWT is never loaded entirely in RAM.
+	 */
+	IndexedBWT(FileReader &BWT, ulint sample_rate, bool verbose=false){
 
-		BWT.at(terminator_position) = 0;
+		build(BWT.size(), [&](ulint i, uchar * buf, ulint len){
 
-		if(sample_rate>0){
-			if(verbose) cout << "\n  Marking positions containing a SA pointer ... ";
-
-			vector<bool> mark_pos = markPositions(verbose);
-			marked_positions = succinct_bitvector( mark_pos );
+			if(i==0)
+				BWT.rewind();
 
-			if(verbose) cout << "  Done.\n";
+			BWT.read(buf,len);
 
-			if(verbose) cout << "\n  Sampling SA pointers ... ";
-			sampleSA(verbose);
-			if(verbose) cout << "  Done.\n";
-		}
+		}, sample_rate, verbose);
 
 	}
 
@@ -200,7 +103,9 @@ public:
 	vector<ulint> convertToTextCoordinates(pair<ulint, ulint> interval){
 
 		vector<ulint> coord;
-		for(uint i=interval.first;i<interval.second;i++)
+		coord.reserve(interval.second-interval.first);
+
+		for(ulint i=interval.first;i<interval.second;i++)
 			coord.push_back( convertToTextCoordinate(i) );
 
 		return coord;
@@ -241,7 +146,11 @@ public:
 		if(interval.first==0 and interval.second==0)//if default interval
 			interval.second = n;
 
-		for(uint i=0;i<length;i++){
+		for(uint i=0;i<length and interval.second>interval.first;i++){
+
+			//digits that do not occur in the text (e.g. in fingerprints of the Z-neighbourhood) have no occurrences
+			if(not inAlphabet(digitAt(W,i)+1))
+				return pair<ulint, ulint>(0,0);
 
 			auto c = remapping[digitAt(W,i)+1];//sum 1 since the BWT is built on the remapped text, where 1 is added to each digit
 
@@ -260,17 +169,29 @@ public:
 	 */
 	pair<ulint, ulint> BS(string P){
 
-		pair<ulint, ulint> interval = pair<ulint, ulint>(0,n);
+		return BS(P,P.length(),pair<ulint, ulint>(0,n));
+
+	}
+
+	/*
+	 * 	backward search of the prefix of length 'length' of P, starting from the input interval (which is
+	 * 	the interval of P[length,...,|P|-1]). Returns interval <lower_included, upper_excluded> on the BWT
+	 *
+	 */
+	pair<ulint, ulint> BS(string &P, ulint length, pair<ulint, ulint> interval){
 
-		for(uint i=0;i<P.length();i++){
+		for(ulint i=0;i<length and interval.second>interval.first;i++){
 
-			auto c = (uchar)P.at( (P.length()-1)-i );
+			auto c = (uchar)P.at( (length-1)-i );
 
 			if(c==0){
 				cout << "ERROR while searching pattern in the index: the pattern contains a 0x0 byte (not allowed since it is used as text terminator).\n";
 				exit(0);
 			}
 
+			if(not inAlphabet(c))//character does not occur in the text
+				return pair<ulint, ulint>(0,0);
+
 			c = remapping[c];//apply remapping
 
 			interval.first = FIRST[c] + rank(c,interval.first);
@@ -307,6 +228,24 @@ public:
 
 	}
 
+	/*
+	 * number of characters smaller than c in the BWT interval [l,r). The terminator is counted as the smallest character.
+	 * Used to synchronize the intervals of a bidirectional index.
+	 */
+	ulint smallerSymbols(uchar c, ulint l, ulint r){
+
+		c = remapping[c];
+
+		ulint smaller = bwt_wt.rankLessThan(c,r) - bwt_wt.rankLessThan(c,l);
+
+		//if c>0, the terminator (encoded as 0 in the wavelet tree) is already counted
+		if(c==0 and l<=terminator_position and terminator_position<r)
+			smaller++;
+
+		return smaller;
+
+	}
+
 	~IndexedBWT() {}
 
 	void saveToFile(FILE *fp){
@@ -372,6 +311,17 @@ public:
 
 	ulint length(){return n;}
 
+	uint alphabetSize(){return sigma;}//alphabet size (excluded terminator character)
+
+	//true if c occurs in the text
+	bool inAlphabet(uchar c){return c!=0 and inverse_remapping[remapping[c]]==c;}
+
+	//rank of c in the sorted alphabet, i.e. a value in {0,...,sigma-1}. c must occur in the text
+	uchar remap(uchar c){return remapping[c];}
+
+	//i-th character of the sorted alphabet, i in {0,...,sigma-1}
+	uchar inverseRemap(uchar i){return inverse_remapping[i];}
+
 private:
 
 	//returns symbol stored in the wavelet tree at position i. The terminator is returned as 255
@@ -409,6 +359,149 @@ private:
 
 	}
 
+	/*
+	 * builds the structure on a BWT of length n. read_block(i,buf,len) copies BWT[i,...,i+len-1] in buf:
+	 * the BWT is read sequentially (in blocks) twice: to detect the alphabet and to fill the wavelet tree.
+	 */
+	template<typename block_reader>
+	void build(ulint n, block_reader read_block, ulint sample_rate, bool verbose){
+
+		this->n=n;
+		this->offrate=sample_rate;
+
+		number_of_SA_pointers = (sample_rate==0?0:n/sample_rate + 1);
+
+		if(verbose) cout << " Building indexed BWT data structure" << endl;
+		if(verbose) cout << "  Number of sampled SA pointers = " << number_of_SA_pointers << endl;
+
+		w = ceil(log2(n));
+		if(w<1) w=1;
+
+		ulint nr_of_terminators=0;
+
+		//compute re-mapping to keep alphabet size to a minimum
+		//from text chars -> to integers in {0,...,sigma}. the 0x0 byte is also remapped in 0x0, as the first alphabet character.
+		remapping = vector<uchar>(256,0);
+
+		//detect alphabet
+		vector<uchar> alphabet;
+		vector<bool> char_inserted = vector<bool>(256,false);
+
+		const ulint block_size = 1<<20;
+		vector<uchar> block(block_size);
+
+		for(ulint b=0;b<n;b+=block_size){
+
+			ulint len = std::min(block_size,n-b);
+			read_block(b,block.data(),len);
+
+			for(ulint i=0;i<len;i++){
+
+				if(block[i]==0){//found terminator. Save position
+					terminator_position = b+i;
+					nr_of_terminators++;
+				}else{
+
+					if(not char_inserted.at(block[i])){
+
+						alphabet.push_back(block[i]);
+						char_inserted.at(block[i])=true;
+
+					}
+
+				}
+
+			}
+
+		}
+
+		if(nr_of_terminators!=1){
+
+			cout << "Error (IndexedBWT.cpp): the bwt contains no o more than one 0x0 bytes\n";
+			exit(1);
+
+		}
+
+		sigma = alphabet.size();
+
+		//sort alphabet
+
+		std::sort(alphabet.begin(),alphabet.end());
+
+		//calculate remapping
+		//note: remapping of terminator (0x0) is 0
+
+		for(uint i=0;i<alphabet.size();i++)
+			remapping[alphabet.at(i)] = i;
+
+		//calculate inverse remapping
+
+		inverse_remapping = vector<uchar>(sigma);
+
+		for(uint i=0;i<sigma;i++)
+			inverse_remapping[i] = alphabet.at(i);
+
+		//fill the wavelet tree with the remapped BWT
+
+		if(verbose) cout << "  Building Wavelet tree"<<endl;
+
+		bwt_wt = WaveletTree(std::max(sigma,(uint)1));
+
+		FIRST = vector<ulint>(256,0);
+
+		for(ulint b=0;b<n;b+=block_size){
+
+			ulint len = std::min(block_size,n-b);
+			read_block(b,block.data(),len);
+
+			for(ulint i=0;i<len;i++){
+
+				bwt_wt.push_back(remapping[block[i]]);
+
+				//count number of occurrences of each character
+				if(b+i!=terminator_position)
+					FIRST[remapping[block[i]]]++;
+
+			}
+
+		}
+
+		if(verbose) cout << "   Done." << endl;
+
+		marked_positions =  succinct_bitvector();
+
+		text_pointers =  packed_view_t(w,number_of_SA_pointers);
+
+		log_sigma = bwt_wt.bitsPerSymbol();
+
+		FIRST[TERMINATOR]=0;//first occurrence of terminator char in the first column is at the beginning
+
+		for(uint i=1;i<255;i++)
+			FIRST[i] += FIRST[i-1];
+
+		for(int i=254;i>0;i--)
+			FIRST[i] = FIRST[i-1];
+
+		FIRST[0] = 0;
+
+		for(uint i=0;i<255;i++)
+			FIRST[i]++;
+
+		if(sample_rate>0){
+			if(verbose) cout << "\n  Marking positions containing a SA pointer ... ";
+
+			vector<bool> mark_pos = markPositions(verbose);
+			marked_positions = succinct_bitvector( mark_pos );
+
+			if(verbose) cout << "  Done.\n";
+
+			if(verbose) cout << "\n  Sampling SA pointers ... ";
+			sampleSA(verbose);
+			if(verbose) cout << "  Done.\n";
+		}
+
+	}
+
 	vector<bool> markPositions(bool verbose){//mark 1 every offrate positions of the text on the bwt (vector marked_positions)
 
 		auto marked_pos_vec = vector<bool>(n,false);
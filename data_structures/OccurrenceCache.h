@@ -0,0 +1,191 @@
+/*
+ *  This file is part of BWTIL.
+ *  Copyright (c) by
+ *  Nicola Prezza <nicolapr@gmail.com>
+ *
+ *   BWTIL is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+
+ *   BWTIL is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details (<http://www.gnu.org/licenses/>).
+ */
+
+/*
+ * OccurrenceCache.h
+ *
+ *  Description: bounded, thread-safe cache of fingerprint lookups for the dB-hash. A fingerprint is mapped to its list of
+ *  (located) text occurrences if the BWT interval has at most max_list_length rows, otherwise only to its BWT interval (so that
+ *  very frequent fingerprints save the backward search without filling the cache with long lists).
+ *
+ *  The cache is split in shards, each protected by a mutex. When the memory budget of a shard is exceeded, the oldest entries
+ *  are evicted (FIFO).
+ */
+
+#ifndef OCCURRENCECACHE_H_
+#define OCCURRENCECACHE_H_
+
+#include "../common/common.h"
+#include <mutex>
+#include <atomic>
+#include <deque>
+#include <unordered_map>
+
+namespace bwtil {
+
+class OccurrenceCache {
+
+public:
+
+	struct entry{
+
+		pair<ulint, ulint> interval;//BWT interval of the fingerprint
+		bool located=false;//if true, occ contains the text occurrences of the interval
+		vector<ulint> occ;
+
+	};
+
+	/*
+	 * memory budget in bytes. Fingerprints whose interval has more than max_list_length rows are cached as intervals.
+	 */
+	OccurrenceCache(ulint budget, ulint max_list_length=64){
+
+		this->max_list_length = max_list_length;
+
+		shards = vector<shard>(number_of_shards);
+
+		shard_budget = budget/number_of_shards;
+
+	}
+
+	//returns true and fills e if the fingerprint is in the cache
+	bool find(ulint fingerprint, entry &e){
+
+		shard &s = shards[shardOf(fingerprint)];
+
+		{
+			std::lock_guard<std::mutex> lock(s.m);
+
+			auto it = s.map.find(fingerprint);
+
+			if(it!=s.map.end()){
+
+				e = it->second;
+
+				if(e.located)
+					hits++;
+				else
+					interval_hits++;
+
+				return true;
+
+			}
+
+		}
+
+		misses++;
+
+		return false;
+
+	}
+
+	//should the occurrences of an interval be located and cached? (otherwise, only the interval is cached)
+	bool admitList(pair<ulint, ulint> interval){return interval.second-interval.first <= max_list_length;}
+
+	void insert(ulint fingerprint, entry &e){
+
+		ulint bytes = entryBytes(e);
+
+		if(bytes>shard_budget)
+			return;
+
+		shard &s = shards[shardOf(fingerprint)];
+
+		std::lock_guard<std::mutex> lock(s.m);
+
+		if(s.map.count(fingerprint)>0)//inserted by another thread
+			return;
+
+		while(s.bytes+bytes>shard_budget and s.fifo.size()>0){
+
+			auto it = s.map.find(s.fifo.front());
+			s.bytes -= entryBytes(it->second);
+			s.map.erase(it);
+			s.fifo.pop_front();
+
+			evictions++;
+
+		}
+
+		s.map[fingerprint] = e;
+		s.fifo.push_back(fingerprint);
+		s.bytes += bytes;
+
+	}
+
+	ulint hitCount(){return hits;}//lookups answered with the occurrence list
+	ulint intervalHitCount(){return interval_hits;}//lookups answered with the BWT interval (occurrences still to be located)
+	ulint missCount(){return misses;}
+	ulint evictionCount(){return evictions;}
+
+	double hitRate(){
+
+		ulint lookups = hits+interval_hits+misses;
+
+		return lookups==0 ? 0 : (double)(hits+interval_hits)/lookups;
+
+	}
+
+	ulint size(){//number of cached fingerprints
+
+		ulint size=0;
+
+		for(auto &s : shards){
+
+			std::lock_guard<std::mutex> lock(s.m);
+			size += s.map.size();
+
+		}
+
+		return size;
+
+	}
+
+private:
+
+	struct shard{
+
+		shard(){};
+		shard(const shard &){};//mutexes are not copyable: shards are created empty
+
+		std::mutex m;
+		std::unordered_map<ulint, entry> map;
+		std::deque<ulint> fifo;//insertion order
+		ulint bytes=0;
+
+	};
+
+	inline ulint shardOf(ulint fingerprint){return (fingerprint*0x9E3779B97F4A7C15ULL)>>(64-log_shards);}
+
+	//approximate memory used by an entry (map node, FIFO slot and occurrences)
+	static ulint entryBytes(entry &e){return 64 + e.occ.size()*sizeof(ulint);}
+
+	static const uint log_shards = 6;
+	static const uint number_of_shards = 1<<log_shards;
+
+	vector<shard> shards;
+	ulint shard_budget=0;
+	ulint max_list_length=64;
+
+	std::atomic<ulint> hits{0};
+	std::atomic<ulint> interval_hits{0};
+	std::atomic<ulint> misses{0};
+	std::atomic<ulint> evictions{0};
+
+};
+
+} /* namespace bwtil */
+#endif /* OCCURRENCECACHE_H_ */
@@ -0,0 +1,638 @@
+/*
+ *  This file is part of BWTIL.
+ *  Copyright (c) by
+ *  Nicola Prezza <nicolapr@gmail.com>
+ *
+ *   BWTIL is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+
+ *   BWTIL is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details (<http://www.gnu.org/licenses/>).
+ */
+
+/*
+ * SequenceFile.h
+ *
+ *  Description: random access to the sequence contained in a FASTA, FASTQ (possibly gzipped) or 2-bit file, i.e. to the
+ *  concatenation of its records without headers, newlines and qualities (the text obtained by stripping the file).
+ *
+ *  - plain FASTA files with fixed line width inside each record (as required by samtools faidx) are indexed in one pass and
+ *    then read directly from disk. Characters other than ACGTN (case insensitive) are returned as N, as in the RAM layout.
+ *  - 2-bit files (UCSC .2bit format: 4 bases per byte, runs of N and runs of lowercase bases in side tables) are read directly
+ *    from disk: 4 times fewer bytes than the plain sequence.
+ *  - gzipped files, FASTQ files and FASTA files with irregular lines are streamed once (kseq) and packed in RAM with the same
+ *    2-bit layout (n/4 bytes + runs). In this case, characters other than ACGTN (case insensitive) are stored as N.
+ *
+ *  gzipped input requires zlib (compile with -DBWTIL_ZLIB and link with -lz).
+ */
+
+#ifndef SEQUENCEFILE_H_
+#define SEQUENCEFILE_H_
+
+#include "../common/common.h"
+#include "../extern/kseq.h"
+
+#ifdef BWTIL_ZLIB
+#include <zlib.h>
+KSEQ_INIT(gzFile, gzread)
+#else
+static inline int kseq_fread(FILE * f, void * buf, int len){return fread(buf, 1, len, f);}
+KSEQ_INIT(FILE *, kseq_fread)
+#endif
+
+namespace bwtil {
+
+class SequenceFile {
+
+public:
+
+	SequenceFile(){};
+
+	SequenceFile(string path, bool verbose=false){
+
+		this->path = path;
+
+		fp = fopen(path.c_str(), "rb");
+
+		if (fp == NULL){
+			cout << "Error while opening file " << path <<endl;
+			exit(1);
+		}
+
+		uchar magic[4]={0,0,0,0};
+		ulint magic_length = fread(magic, sizeof(uchar), 4, fp);
+
+		if(magic_length>=2 and magic[0]==0x1f and magic[1]==0x8b){
+
+#ifndef BWTIL_ZLIB
+			cout << "Error: " << path << " is gzipped, but BWTIL was compiled without zlib support (-DBWTIL_ZLIB)." << endl;
+			exit(1);
+#endif
+
+			if(verbose) cout << " Packing the sequences of the gzipped file " << path << " in RAM ..." << flush;
+			pack();
+
+		}else if(magic_length==4 and (read32(magic,false)==twobit_signature or read32(magic,true)==twobit_signature)){
+
+			if(verbose) cout << " Reading the index of the 2-bit file " << path << " ..." << flush;
+			indexTwoBit(read32(magic,true)==twobit_signature);
+
+		}else if(magic_length>0 and magic[0]=='>'){
+
+			if(verbose) cout << " Indexing the FASTA file " << path << " ..." << flush;
+
+			if(not indexFasta()){
+
+				if(verbose) cout << " irregular line lengths: packing the sequences in RAM ..." << flush;
+				pack();
+
+			}
+
+		}else if(magic_length>0 and magic[0]=='@'){
+
+			if(verbose) cout << " Packing the sequences of the FASTQ file " << path << " in RAM ..." << flush;
+			pack();
+
+		}else{
+
+			cout << "Error: " << path << " is not a FASTA, FASTQ or 2-bit file." << endl;
+			exit(1);
+
+		}
+
+		if(verbose) cout << " Done. " << records.size() << " records, total length " << n << endl;
+
+		if(verbose and converted>0)
+			cout << " Warning: " << converted << " characters other than ACGTN have been stored as N." << endl;
+
+	}
+
+	//true if the extension of path is one of the sequence formats (.fa, .fasta, .fna, .fq, .fastq, .2bit, optionally followed by .gz)
+	static bool isSequenceFile(string path){
+
+		string p = path;
+		std::transform(p.begin(), p.end(), p.begin(), ::tolower);
+
+		if(hasSuffix(p,".gz"))
+			p = p.substr(0,p.length()-3);
+
+		for(string ext : {".fa",".fasta",".fna",".fq",".fastq",".2bit"})
+			if(hasSuffix(p,ext))
+				return true;
+
+		return false;
+
+	}
+
+	//copies T[i,...,i+len-1] in buf, where T is the concatenation of the sequences
+	void read(ulint i, uchar * buf, ulint len){
+
+		assert(i+len<=n);
+
+		//first record containing position i
+		ulint r = std::upper_bound(starts.begin(), starts.end(), i) - starts.begin() - 1;
+
+		while(len>0){
+
+			record &rec = records[r];
+
+			ulint j = i-rec.start;//position inside the record
+			ulint l = std::min(len, rec.length-j);
+
+			if(layout==fasta)
+				readFasta(rec,j,buf,l);
+			else
+				readPacked(rec,j,buf,l);
+
+			i += l;
+			buf += l;
+			len -= l;
+			r++;
+
+		}
+
+	}
+
+	ulint size(){return n;}
+
+	ulint numberOfRecords(){return records.size();}
+
+	void close(){
+
+		if(fp!=NULL)
+			fclose(fp);
+
+		fp = NULL;
+
+		packed = vector<uchar>();
+
+	}
+
+private:
+
+	enum file_layout {fasta,twobit,packed_ram};
+
+	//a run of N or of lowercase bases (record coordinates)
+	struct run{
+
+		ulint begin;
+		ulint length;
+
+	};
+
+	struct record{
+
+		ulint start=0;//position in the concatenation of the sequences
+		ulint length=0;
+
+		ulint offset=0;//offset of the first base (fasta) or of the packed bases (2-bit file or RAM)
+
+		ulint line_bases=0;//fasta only: bases per line and bytes per line (newline included)
+		ulint line_bytes=0;
+
+		vector<run> n_runs;
+		vector<run> mask_runs;
+
+	};
+
+	static bool hasSuffix(string &s, string suffix){
+
+		return s.length()>=suffix.length() and s.compare(s.length()-suffix.length(), suffix.length(), suffix)==0;
+
+	}
+
+	static uint32_t read32(uchar * b, bool swap){
+
+		if(swap)
+			return ((uint32_t)b[0]<<24) | ((uint32_t)b[1]<<16) | ((uint32_t)b[2]<<8) | (uint32_t)b[3];
+
+		return ((uint32_t)b[3]<<24) | ((uint32_t)b[2]<<16) | ((uint32_t)b[1]<<8) | (uint32_t)b[0];
+
+	}
+
+	uint32_t read32(){
+
+		uchar b[4];
+
+		if(fread(b, sizeof(uchar), 4, fp)!=4){
+			cout << "Error: unexpected end of the 2-bit file " << path << endl;
+			exit(1);
+		}
+
+		return read32(b,swap);
+
+	}
+
+	void addRecord(record &rec){
+
+		if(rec.length==0)
+			return;
+
+		rec.start = n;
+		n += rec.length;
+
+		starts.push_back(rec.start);
+		records.push_back(rec);
+
+	}
+
+	/*
+	 * one scan of the file: for each record, offset of the first base and line width. Returns false if a record has lines of
+	 * different widths (other than the last one, which can be shorter).
+	 */
+	bool indexFasta(){
+
+		layout = fasta;
+
+		fseek(fp, 0, SEEK_SET);
+
+		const ulint buffer_size = 1<<20;
+		vector<uchar> buffer(buffer_size);
+
+		record rec;
+		bool header=false;//inside a header line
+		bool line_start=true;
+		bool last_line=false;//a line shorter than line_bases has been read: the record must end
+
+		ulint pos=0;//file offset of the current byte
+		ulint line_begin=0;//file offset of the beginning of the current line
+		ulint bases=0;//bases in the current line
+
+		//closes a sequence line of 'bases' bases ending (newline included, if any) at file offset end
+		auto endLine = [&](ulint end, bool newline) -> bool {
+
+			ulint bytes = end-line_begin;
+
+			if(bases==0)//empty line: only allowed at the end of the record
+				last_line = true;
+			else if(last_line)
+				return false;
+			else if(rec.line_bases==0){
+				rec.line_bases = bases;
+				rec.line_bytes = bytes;
+			}else if(bases<rec.line_bases or (bases==rec.line_bases and not newline))//the last line of the file can lack the newline
+				last_line = true;
+			else if(bases>rec.line_bases or bytes!=rec.line_bytes)
+				return false;
+
+			rec.length += bases;
+
+			return true;
+
+		};
+
+		ulint len;
+		while((len = fread(buffer.data(), sizeof(uchar), buffer_size, fp))>0){
+
+			for(ulint k=0;k<len;k++,pos++){
+
+				uchar c = buffer[k];
+
+				if(line_start){
+
+					line_start=false;
+					line_begin=pos;
+					bases=0;
+
+					if(c=='>'){
+
+						addRecord(rec);
+						rec = record();
+
+						header=true;
+						last_line=false;
+
+					}
+
+				}
+
+				if(c=='\n'){
+
+					if(header){
+
+						header=false;
+						rec.offset = pos+1;
+
+					}else if(not endLine(pos+1,true)){
+
+						return false;
+
+					}
+
+					line_start=true;
+
+				}else if(not header and c!='\r'){
+
+					bases++;
+
+					if(baseCode(toupper(c))==4 and toupper(c)!='N')
+						converted++;
+
+				}
+
+			}
+
+		}
+
+		if(not line_start and not header and not endLine(pos,false))//last line without newline
+			return false;
+
+		addRecord(rec);
+
+		return true;
+
+	}
+
+	void indexTwoBit(bool swap){
+
+		layout = twobit;
+		this->swap = swap;
+
+		fseek(fp, 4, SEEK_SET);
+
+		uint32_t version = read32();
+		uint32_t sequences = read32();
+		read32();//reserved
+
+		if(version>1){
+			cout << "Error: unsupported 2-bit file version " << version << endl;
+			exit(1);
+		}
+
+		vector<ulint> offsets;
+
+		for(uint32_t s=0;s<sequences;s++){
+
+			uchar name_length;
+			char name[256];
+
+			if(fread(&name_length, sizeof(uchar), 1, fp)!=1 or fread(name, sizeof(char), name_length, fp)!=name_length){
+				cout << "Error: unexpected end of the 2-bit file " << path << endl;
+				exit(1);
+			}
+
+			ulint offset = read32();
+
+			if(version==1)//64-bit offsets
+				offset = swap ? (offset<<32) | read32() : offset | ((ulint)read32()<<32);
+
+			offsets.push_back(offset);
+
+		}
+
+		for(ulint offset : offsets){
+
+			fseek(fp, offset, SEEK_SET);
+
+			record rec;
+
+			rec.length = read32();
+
+			rec.n_runs = readRuns();
+			rec.mask_runs = readRuns();
+
+			read32();//reserved
+
+			rec.offset = offset + 16 + 8*(rec.n_runs.size()+rec.mask_runs.size());
+
+			addRecord(rec);
+
+		}
+
+	}
+
+	vector<run> readRuns(){
+
+		uint32_t count = read32();
+
+		vector<run> runs(count);
+
+		for(uint32_t k=0;k<count;k++)
+			runs[k].begin = read32();
+
+		for(uint32_t k=0;k<count;k++)
+			runs[k].length = read32();
+
+		return runs;
+
+	}
+
+	//streams the records (kseq) and packs them in RAM, 4 bases per byte (2-bit file layout)
+	void pack(){
+
+		layout = packed_ram;
+
+		fclose(fp);
+		fp = NULL;
+
+		//discard the records indexed by a failed indexFasta()
+		records.clear();
+		starts.clear();
+		n=0;
+		converted=0;
+
+#ifdef BWTIL_ZLIB
+		gzFile f = gzopen(path.c_str(), "r");
+		if(f==NULL){
+#else
+		FILE * f = fopen(path.c_str(), "rb");
+		if(f==NULL){
+#endif
+			cout << "Error while opening file " << path <<endl;
+			exit(1);
+		}
+
+		kseq_t * seq = kseq_init(f);
+
+		while(kseq_read(seq)>=0){
+
+			record rec;
+
+			rec.length = seq->seq.l;
+			rec.offset = packed.size();
+
+			packed.resize(packed.size() + (rec.length+3)/4, 0);
+
+			for(ulint j=0;j<rec.length;j++){
+
+				uchar c = seq->seq.s[j];
+				uchar upper = toupper(c);
+
+				if(c!=upper)
+					addToRun(rec.mask_runs,j);
+
+				if(baseCode(upper)<4)
+					packed[rec.offset + j/4] |= baseCode(upper) << (6-2*(j%4));
+				else{
+
+					addToRun(rec.n_runs,j);
+
+					if(upper!='N')
+						converted++;
+
+				}
+
+			}
+
+			addRecord(rec);
+
+		}
+
+		kseq_destroy(seq);
+
+#ifdef BWTIL_ZLIB
+		gzclose(f);
+#else
+		fclose(f);
+#endif
+
+	}
+
+	static void addToRun(vector<run> &runs, ulint j){
+
+		if(runs.size()>0 and runs.back().begin+runs.back().length==j)
+			runs.back().length++;
+		else
+			runs.push_back({j,1});
+
+	}
+
+	//bases [j,j+len) of a record stored in a plain FASTA file
+	void readFasta(record &rec, ulint j, uchar * buf, ulint len){
+
+		ulint begin = rec.offset + (j/rec.line_bases)*rec.line_bytes + j%rec.line_bases;
+		ulint end = rec.offset + ((j+len-1)/rec.line_bases)*rec.line_bytes + (j+len-1)%rec.line_bases + 1;
+
+		scratch.resize(end-begin);
+
+		fseek(fp, begin, SEEK_SET);
+		if(fread(scratch.data(), sizeof(uchar), end-begin, fp)!=end-begin){
+			cout << "Error while reading file " << path <<endl;
+			exit(1);
+		}
+
+		//copy the bases skipping the newlines
+		ulint k=0;
+		ulint in_line = rec.line_bases - j%rec.line_bases;//bases left in the current line
+
+		while(len>0){
+
+			ulint l = std::min(len,in_line);
+
+			memcpy(buf, scratch.data()+k, l);
+
+			for(ulint p=0;p<l;p++)//characters other than ACGTN become N (n if lowercase), as in the packed layouts
+				if(baseCode(toupper(buf[p]))==4 and toupper(buf[p])!='N')
+					buf[p] = buf[p]!=toupper(buf[p]) ? 'n' : 'N';
+
+			buf += l;
+			len -= l;
+			k += l + (rec.line_bytes-rec.line_bases);
+			in_line = rec.line_bases;
+
+		}
+
+	}
+
+	//bases [j,j+len) of a record stored in 2-bit format (on disk or in RAM)
+	void readPacked(record &rec, ulint j, uchar * buf, ulint len){
+
+		ulint first_byte = j/4;
+		ulint bytes = (j+len-1)/4 - first_byte + 1;
+
+		uchar * data;
+
+		if(layout==packed_ram){
+
+			data = packed.data() + rec.offset + first_byte;
+
+		}else{
+
+			scratch.resize(bytes);
+
+			fseek(fp, rec.offset + first_byte, SEEK_SET);
+			if(fread(scratch.data(), sizeof(uchar), bytes, fp)!=bytes){
+				cout << "Error while reading file " << path <<endl;
+				exit(1);
+			}
+
+			data = scratch.data();
+
+		}
+
+		for(ulint k=0;k<len;k++){
+
+			ulint p = j+k;
+			buf[k] = base( (data[p/4 - first_byte] >> (6-2*(p%4))) & 3 );
+
+		}
+
+		applyRuns(rec.n_runs, j, buf, len, false);
+		applyRuns(rec.mask_runs, j, buf, len, true);
+
+	}
+
+	//overwrites with N (or turns to lowercase) the positions of buf = bases [j,j+len) covered by the runs
+	static void applyRuns(vector<run> &runs, ulint j, uchar * buf, ulint len, bool mask){
+
+		//first run that may overlap [j,j+len)
+		auto it = std::upper_bound(runs.begin(), runs.end(), j, [](ulint x, const run &r){return x < r.begin;});
+
+		if(it!=runs.begin())
+			it--;
+
+		for(;it!=runs.end() and it->begin<j+len;it++){
+
+			ulint b = std::max(it->begin,j);
+			ulint e = std::min(it->begin+it->length,j+len);
+
+			for(ulint p=b;p<e;p++)
+				buf[p-j] = mask ? tolower(buf[p-j]) : 'N';
+
+		}
+
+	}
+
+	static const uint32_t twobit_signature = 0x1A412743;
+
+	//2-bit codes: T=0, C=1, A=2, G=3 (4 = not a base)
+	static uchar baseCode(uchar c){
+
+		switch(c){
+
+			case 'T': return 0;
+			case 'C': return 1;
+			case 'A': return 2;
+			case 'G': return 3;
+			default: return 4;
+
+		}
+
+	}
+
+	static uchar base(uint code){return "TCAG"[code];}
+
+	string path;
+	FILE * fp=NULL;
+	bool swap=false;//2-bit file with the other endianness
+
+	file_layout layout=fasta;
+
+	vector<record> records;
+	vector<ulint> starts;//start position of each record
+
+	ulint n=0;//total length of the sequences
+
+	vector<uchar> packed;//packed sequences (packed_ram layout)
+	vector<uchar> scratch;//raw bytes read from disk
+
+	ulint converted=0;//characters other than ACGTN, returned as N
+
+};
+
+} /* namespace bwtil */
+#endif /* SEQUENCEFILE_H_ */
@@ -0,0 +1,106 @@
+/*
+ *  This file is part of BWTIL.
+ *  Copyright (c) by
+ *  Nicola Prezza <nicolapr@gmail.com>
+ *
+ *   BWTIL is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+
+ *   BWTIL is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details (<http://www.gnu.org/licenses/>).
+ */
+
+/*
+ * SequenceFileReader.h
+ *
+ *      Description: same interface of FileReader, but reads the sequence contained in a FASTA, FASTQ (possibly gzipped)
+ *      or 2-bit file (see SequenceFile.h) instead of the raw bytes of the file.
+ */
+
+#ifndef SEQUENCEFILEREADER_H_
+#define SEQUENCEFILEREADER_H_
+
+#include "../common/common.h"
+#include "SequenceFile.h"
+
+namespace bwtil {
+
+class SequenceFileReader {
+
+public:
+
+	SequenceFileReader(){};
+
+	SequenceFileReader(string path, bool verbose=false){
+
+		sf = SequenceFile(path,verbose);
+
+		n = sf.size();
+		pos = 0;
+
+	}
+
+	uchar get(){
+
+		if(pos>=buffer_start+buffer.size()){
+
+			buffer_start = pos;
+			buffer.resize(std::min(buffer_size,n-pos));
+			sf.read(pos,buffer.data(),buffer.size());
+
+		}
+
+		return buffer[pos++ - buffer_start];
+
+	}
+
+	void rewind(){
+
+		pos=0;
+		buffer_start=0;
+		buffer.clear();
+
+	}
+
+	void read(uchar * buf, ulint n){
+
+		sf.read(pos,buf,n);
+		pos+=n;
+
+	}
+
+	string toString(){
+
+		string s(n,'e');//allocate space for n chars
+		sf.read(0,(uchar *)s.data(),n);
+
+		return s;
+
+	}
+
+	ulint size(){return n;}
+
+	bool eof(){return pos>=n;}
+
+	void close(){sf.close();}
+
+private:
+
+	static const ulint buffer_size = 1<<20;
+
+	SequenceFile sf;
+
+	ulint n=0;
+	ulint pos=0;
+
+	vector<uchar> buffer;//buffer of get(): sequence[buffer_start,...,buffer_start+buffer.size()-1]
+	ulint buffer_start=0;
+
+};
+
+} /* namespace bwtil */
+#endif /* SEQUENCEFILEREADER_H_ */
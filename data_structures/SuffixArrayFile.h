@@ -0,0 +1,407 @@
+/*
+ *  This file is part of BWTIL.
+ *  Copyright (c) by
+ *  Nicola Prezza <nicolapr@gmail.com>
+ *
+ *   BWTIL is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+
+ *   BWTIL is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details (<http://www.gnu.org/licenses/>).
+ */
+
+/*
+ * SuffixArrayFile.h
+ *
+ *  Description: buffered reader/writer for suffix array files. Three formats are supported:
+ *
+ *  - legacy: n entries of 8 bytes each, no header.
+ *  - packed: header + n entries of w=ceil(log2 n) bits each, packed in 64-bit little-endian words (from the least significant bit).
+ *  - bytes: header + n entries of ceil(w/8) bytes each (little-endian). For a 3 Gbp genome this is 5 bytes per entry.
+ *
+ *  Header (24 bytes): magic "BWTILSA" + version byte, format byte, width in bits, 6 reserved bytes, n (8 bytes).
+ *
+ *  The reader detects the format automatically: files without the magic string are legacy files.
+ *
+ */
+
+#ifndef SUFFIXARRAYFILE_H_
+#define SUFFIXARRAYFILE_H_
+
+#include "../common/common.h"
+
+namespace bwtil {
+
+enum sa_format {sa_legacy = 0, sa_packed = 1, sa_bytes = 2};
+
+//header magic (7 characters) and version
+static const char sa_file_magic[8] = {'B','W','T','I','L','S','A',1};
+
+class SuffixArrayFileWriter {
+
+public:
+
+	SuffixArrayFileWriter(){};
+
+	/*
+	 * open path for writing n suffix array entries in the given format.
+	 */
+	SuffixArrayFileWriter(string path, ulint n, sa_format format = sa_legacy){
+
+		this->n = n;
+		this->format = format;
+
+		if ((fp = fopen(path.c_str(), "wb")) == NULL) {
+			VERBOSE_CHANNEL<< "Cannot open file "  << path <<endl;
+			exit(1);
+		}
+
+		width = (n<=1 ? 1 : intlog2(n-1));
+
+		if(format == sa_bytes)
+			width = ((width+7)/8)*8;
+
+		if(format == sa_legacy)
+			width = 64;
+
+		if(format != sa_legacy){
+
+			uchar header[16] = {0};
+
+			for(uint i=0;i<8;i++)
+				header[i] = sa_file_magic[i];
+
+			header[8] = format;
+			header[9] = width;
+
+			fwrite(header, sizeof(uchar), 16, fp);
+			fwrite(&n, sizeof(ulint), 1, fp);
+
+		}
+
+		buffer.reserve(buffer_size);
+
+	}
+
+	inline void write(ulint x){
+
+		assert(x<n);
+
+		switch(format){
+
+			case sa_legacy: push(x); break;
+
+			case sa_bytes:
+
+				for(uint i=0;i<width/8;i++)
+					pushByte( (x>>(8*i)) & 255 );
+
+			break;
+
+			case sa_packed:
+
+				current |= x << used_bits;
+
+				if(used_bits + width >= 64){
+
+					push(current);
+
+					uint remaining = used_bits + width - 64;
+					current = (used_bits==0 ? 0 : x >> (64-used_bits));
+					used_bits = remaining;
+
+				}else{
+
+					used_bits += width;
+
+				}
+
+			break;
+
+		}
+
+		written++;
+
+	}
+
+	void write(const ulint *buf, ulint len){
+
+		for(ulint i=0;i<len;i++)
+			write(buf[i]);
+
+	}
+
+	//flush buffers and close the file
+	void close(){
+
+		if(written != n){
+			cout << "Error: " << written << " suffix array entries written instead of " << n << endl;
+			exit(1);
+		}
+
+		if(format == sa_packed and used_bits>0)
+			push(current);
+
+		flush();
+
+		//bytes format: write only the used bytes of the last word
+		if(format == sa_bytes and byte_pos>0)
+			fwrite(&current, sizeof(uchar), byte_pos, fp);
+
+		fclose(fp);
+
+	}
+
+	uint bitsPerEntry(){return width;}
+
+private:
+
+	inline void push(ulint x){
+
+		buffer.push_back(x);
+
+		if(buffer.size()==buffer_size)
+			flush();
+
+	}
+
+	//bytes are accumulated in 'current' and pushed one word at a time
+	inline void pushByte(uchar b){
+
+		current |= ((ulint)b) << (8*byte_pos);
+		byte_pos++;
+
+		if(byte_pos==8){
+
+			push(current);
+			current = 0;
+			byte_pos = 0;
+
+		}
+
+	}
+
+	void flush(){
+
+		if(buffer.size()>0)
+			fwrite(buffer.data(), sizeof(ulint), buffer.size(), fp);
+
+		buffer.clear();
+
+	}
+
+	static const ulint buffer_size = 1<<17;//words
+
+	FILE *fp = NULL;
+
+	ulint n = 0;
+	ulint written = 0;
+	sa_format format = sa_legacy;
+	uint width = 64;
+
+	vector<ulint> buffer;
+
+	ulint current = 0;//partial word
+	uint used_bits = 0;//packed format: bits used in current
+	uint byte_pos = 0;//bytes format: bytes used in current
+
+};
+
+class SuffixArrayFileReader {
+
+public:
+
+	SuffixArrayFileReader(){};
+
+	/*
+	 * open a suffix array file and detect its format
+	 */
+	SuffixArrayFileReader(string path){
+
+		if ((fp = fopen(path.c_str(), "rb")) == NULL) {
+			VERBOSE_CHANNEL<< "Cannot open file "  << path <<endl;
+			exit(1);
+		}
+
+		fseek(fp, 0, SEEK_END);
+		ulint file_size = ftell(fp);
+		fseek(fp, 0, SEEK_SET);
+
+		uchar header[16] = {0};
+		bool has_header = false;
+
+		if(file_size >= 24 and fread(header, sizeof(uchar), 16, fp) == 16){
+
+			has_header = true;
+
+			for(uint i=0;i<8;i++)
+				has_header = has_header and header[i]==(uchar)sa_file_magic[i];
+
+		}
+
+		if(has_header){
+
+			format = (sa_format)header[8];
+			width = header[9];
+
+			ulint numBytes = fread(&n, sizeof(ulint), 1, fp);
+			assert(numBytes>0);
+			numBytes++;//avoids "variable not used" warning
+
+			if((format != sa_packed and format != sa_bytes) or width == 0 or width > 64 or (format==sa_bytes and width%8 != 0)){
+				cout << "Error: unrecognized suffix array file format in " << path << endl;
+				exit(1);
+			}
+
+		}else{
+
+			format = sa_legacy;
+			width = 64;
+			n = file_size/sizeof(ulint);
+
+			fseek(fp, 0, SEEK_SET);
+
+		}
+
+		buffer = vector<ulint>(buffer_size);
+
+	}
+
+	/*
+	 * read at most len entries in buf. returns the number of entries read (0 at the end of the file)
+	 */
+	ulint read(ulint *buf, ulint len){
+
+		len = std::min(len, n-entries_read);
+
+		for(ulint i=0;i<len;i++){
+
+			switch(format){
+
+				case sa_legacy: buf[i] = nextWord(); break;
+
+				case sa_bytes: {
+
+					ulint x = 0;
+
+					for(uint b=0;b<width/8;b++)
+						x |= ((ulint)nextByte()) << (8*b);
+
+					buf[i] = x;
+
+				} break;
+
+				case sa_packed: {
+
+					if(available_bits==0){
+						current = nextWord();
+						available_bits = 64;
+					}
+
+					uint consumed = 64-available_bits;
+					ulint x = current >> consumed;
+
+					if(width > available_bits){
+
+						//entry spans two words
+						ulint lo_bits = available_bits;
+						current = nextWord();
+						x |= current << lo_bits;
+						available_bits = 64 - (width - lo_bits);
+
+					}else{
+
+						available_bits -= width;
+
+					}
+
+					if(width<64)
+						x &= (((ulint)1)<<width)-1;
+
+					buf[i] = x;
+
+				} break;
+
+			}
+
+		}
+
+		entries_read += len;
+
+		return len;
+
+	}
+
+	//number of entries in the file
+	ulint length(){return n;}
+
+	sa_format fileFormat(){return format;}
+
+	uint bitsPerEntry(){return width;}
+
+	void close(){fclose(fp);}
+
+private:
+
+	inline ulint nextWord(){
+
+		if(buffer_pos==buffer_length){
+
+			//read bytes: the last word of packed/bytes files can be partial
+			ulint bytes = fread(buffer.data(), sizeof(uchar), buffer_size*sizeof(ulint), fp);
+
+			if(bytes==0){
+				cout << "Error: premature end of the SA file\n";
+				exit(1);
+			}
+
+			if(bytes%sizeof(ulint) != 0)
+				buffer[bytes/sizeof(ulint)] &= (((ulint)1)<<(8*(bytes%sizeof(ulint))))-1;
+
+			buffer_length = (bytes+sizeof(ulint)-1)/sizeof(ulint);
+			buffer_pos = 0;
+
+		}
+
+		return buffer[buffer_pos++];
+
+	}
+
+	inline uchar nextByte(){
+
+		if(byte_pos==0){
+			current = nextWord();
+		}
+
+		uchar b = (current >> (8*byte_pos)) & 255;
+		byte_pos = (byte_pos+1)%8;
+
+		return b;
+
+	}
+
+	static const ulint buffer_size = 1<<17;//words
+
+	FILE *fp = NULL;
+
+	ulint n = 0;
+	ulint entries_read = 0;
+	sa_format format = sa_legacy;
+	uint width = 64;
+
+	vector<ulint> buffer;
+	ulint buffer_pos = 0;
+	ulint buffer_length = 0;
+
+	ulint current = 0;
+	uint available_bits = 0;//packed format: bits of current not yet read
+	uint byte_pos = 0;//bytes format: next byte of current
+
+};
+
+} /* namespace bwtil */
+#endif /* SUFFIXARRAYFILE_H_ */
@@ -40,30 +40,21 @@ public:
 
 		if (verbose) cout << "  Building Wavelet tree"<<endl;
 
-		this->n = text.length();
-		sigma = 0;
+		uint sigma = 0;
 
-		for(ulint i=0;i<n;i++)
+		for(ulint i=0;i<text.length();i++)
 			if((uchar)text.at(i)>sigma)
 				sigma = (uchar)text.at(i);
 
-		sigma++;
-
-		log_sigma = ceil(log2(sigma));
-
-		number_of_nodes = ((ulint)1<<log_sigma)-1;
+		*this = WaveletTree(sigma+1);
 
 		if (verbose) cout << "   Number of nodes = "<< number_of_nodes << endl;
 
 		if (verbose) cout << "   filling nodes ... " << endl;
 
-		nodes = vector<succinct_bitvector>(number_of_nodes);
-
-		uint node = root();
-
 		int perc=0,last_perc=-1;
 
-		for(ulint i=0;i<n;i++){
+		for(ulint i=0;i<text.length();i++){
 
 			if(perc>last_perc and perc%10==0){
 
@@ -72,23 +63,48 @@ public:
 
 			}
 
-			for(ulint j=0;j<log_sigma;j++){
+			push_back(text.at(i));
 
-				bool bit = bitInChar((uchar)text.at(i),j);
+			perc = (100*i)/text.length();
 
-				nodes[node].push_back(bit);
+		}
 
-				node = (bit?child1(node):child0(node));
+		if (verbose) cout << "   Done." << endl;
 
-			}
+	}
+
+	/*
+	 * empty wavelet tree on the alphabet {0,...,sigma-1}. The text is then appended with push_back (e.g. while streaming it from disk)
+	 */
+	WaveletTree(uint sigma){
+
+		this->n = 0;
+		this->sigma = sigma;
+
+		log_sigma = ceil(log2(sigma));
+
+		number_of_nodes = ((ulint)1<<log_sigma)-1;
+
+		nodes = vector<succinct_bitvector>(number_of_nodes);
+
+	}
+
+	//append character c (c < sigma) at the end of the text
+	inline void push_back(uchar c){
+
+		uint node = root();
+
+		for(ulint j=0;j<log_sigma;j++){
+
+			bool bit = bitInChar(c,j);
 
-			node = root();
+			nodes[node].push_back(bit);
 
-			perc = (100*i)/n;
+			node = (bit?child1(node):child0(node));
 
 		}
 
-		if (verbose) cout << "   Done." << endl;
+		n++;
 
 	}
 
@@ -98,6 +114,32 @@ public:
 
 	}
 
+	inline ulint rankLessThan(uchar c, ulint i){//number of characters smaller than 'c' before position i excluded
+
+		ulint result = 0;
+		ulint node = root();
+
+		for(uint level=0;level<height() and nodes[node].length()>0;level++){
+
+			if(bitInChar(c,level)==0){
+
+				i = nodes[node].rank0(i);
+				node = child0(node);
+
+			}else{
+
+				result += nodes[node].rank0(i);
+				i = nodes[node].rank1(i);
+				node = child1(node);
+
+			}
+
+		}
+
+		return result;
+
+	}
+
 	inline uchar charAt(ulint i){
 
 		uchar c=0;
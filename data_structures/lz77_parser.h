@@ -33,11 +33,30 @@
 #include "../common/common.h"
 #include "DynamicBWT.h"
 #include "dynamic_vector.h"
+#include "packed_dynamic_vector.h"
+#include "packed_dynamic_bitvector.h"
+#include <type_traits>
 
 namespace bwtil {
 
+/*
+ * token: an element of the parse, in the form (source, length, next character). The phrase text is never stored: a phrase
+ * is either a copy of length characters starting at start_position, or (start_position_is_defined = false) the first
+ * occurrence of the character 'character' (length 1).
+ */
+struct lz77_token{
+
+	ulint start_position;
+	ulint length;
+	//copies: character following the phrase in the text (first character of the next phrase, 0 at the end of the stream)
+	uchar character;
+	//phrases composed only by the first occurrence of a character in the text do not have a defined start position
+	bool start_position_is_defined;
+
+};
+
 template <	typename bitvector_type = bitv,
-			class dynamic_vector_type = dynamic_vector_t
+			class dynamic_vector_type = packed_dynamic_vector_t
 		>
 class lz77_parser {
 
@@ -47,17 +66,7 @@ public:
 
 	lz77_parser(){};
 
-	/*
-	 * token: an element of the parse
-	 */
-	struct token{
-
-		string phrase;
-		ulint start_position;
-		//phrases composed only by the first occurrence of a character in the text do not have a defined start position
-		bool start_position_is_defined;
-
-	};
+	typedef lz77_token token;
 
 	/*
 	 * Compute online the lz77 parse of the input stream. Requires as input also the characters with
@@ -72,13 +81,23 @@ public:
 	 * 									to compute this parameter.
 	 * \param sample_rate : Store SA pointers every sample_rate positions of the dynamic BWT
 	 * \param verbose
+	 * \param window : if > 0, sliding-window parse: phrases are at most window characters long and their source starts
+	 * 					at most window characters before the phrase. The oldest characters are removed from the dynamic
+	 * 					BWT, which holds at most 2*window characters (the window and the current phrase): memory does
+	 * 					not grow with the stream. Requires a bitvector_type with remove (e.g. packed_dynamic_bitvector_t).
 	 *
 	 *
 	 */
-	lz77_parser(std::istream & input, set<pair<uchar,ulint> > alphabet_and_frequencies, ulint sample_rate = 8, bool verbose = false){
+	lz77_parser(std::istream & input, set<pair<uchar,ulint> > alphabet_and_frequencies, ulint sample_rate = 8, bool verbose = false, ulint window = 0){
 
 		this->input = &input;
 		this->verbose = verbose;
+		this->window = window;
+
+		if(window>0 and not has_remove<bitvector_type>::value){
+			cout << "Error: the windowed LZ77 parse requires a bitvector with remove (e.g. packed_dynamic_bitvector_t)." << endl;
+			exit(1);
+		}
 
 		//compute input length
 		n = 0;
@@ -104,6 +123,11 @@ public:
 		for(auto s : alphabet_and_frequencies)
 			freqs[ uchar_to_int[s.first] ] = s.second;
 
+		//windowed mode: the dynamic BWT never contains more than 2*window characters
+		if(window>0)
+			for(auto &f : freqs)
+				f = std::min(f,2*window);
+
 		dbwt = dynamic_bwt_type(freqs, sample_rate);
 
 		if(verbose)
@@ -130,7 +154,11 @@ public:
 
 		//if eof reached, return empty token
 		if(position==n)
-			return {string(),0,false};
+			return {0,0,0,false};
+
+		//windowed mode: remove from the BWT the characters that are not in the window anymore
+		if(window>0)
+			slide_window(std::integral_constant<bool,has_remove<bitvector_type>::value>());
 
 		//current interval in the BWT. Start with full BWT
 		pair<ulint,ulint> interval = {0,dbwt.size()};
@@ -144,8 +172,8 @@ public:
 		char c = read_char();
 		interval = dbwt.BS(interval,uchar_to_int[(uchar)c]);
 
-		//current phrase: at least 1 character
-		string phrase;
+		//length of the current phrase: at least 1 character
+		ulint length = 0;
 
 		//if interval is empty here, we have the first occurrence of a character
 		if(interval.second <= interval.first){
@@ -157,8 +185,7 @@ public:
 			mismatching_character=0;
 
 			//phrase is only c
-			phrase = string()+c;
-			return {phrase,0,false};
+			return {0,1,(uchar)c,false};
 
 		}
 
@@ -168,15 +195,14 @@ public:
 
 		if(position==n){
 
-			//phrase is only c
-			phrase = string()+c;
+			//phrase is only c, and the stream is finished
 
 			//character occurs before, so locate an occurrence
 			//dbwt.locate_right(position_on_bwt) returns position of the occurrence
 			//counting positions from the right. This is what we want since
 			//we are building the BWT of the reversed text. We subtract 1
 			//because there is a terminator character.
-			return {phrase, dbwt.locate_right(position_on_bwt)-1, true};
+			return {dbwt.locate_right(position_on_bwt)-1+removed, 1, 0, true};
 
 		}
 
@@ -184,7 +210,7 @@ public:
 		while(interval.second > interval.first and position < n){
 
 			//append c to the current phrase
-			phrase = string(phrase)+c;
+			length++;
 
 			//extend BWT and obtain position where new suffix has been inserted
 			ulint o = dbwt.extend(uchar_to_int[(uchar)c]);
@@ -204,6 +230,20 @@ public:
 			//extend right side of the interval.
 			interval.second++;
 
+			//windowed mode: the phrase has maximum length. Peek the next character (returned in the token)
+			if(window>0 and length==window){
+
+				if(position<n){
+
+					mismatching_character = read_char();
+					position--;
+
+				}
+
+				break;
+
+			}
+
 			//search next character
 			c = read_char();
 
@@ -221,7 +261,7 @@ public:
 				//I found the character, but stream is finished:
 				//extend phrase and bwt
 
-				phrase = string(phrase)+c;
+				length++;
 
 				ulint o = dbwt.extend(uchar_to_int[(uchar)c]);
 
@@ -236,7 +276,113 @@ public:
 
 		}
 
-		return {phrase,dbwt.locate_right(position_on_bwt)-phrase.size(),true};
+		return {dbwt.locate_right(position_on_bwt)-length+removed, length, (uchar)mismatching_character, true};
+
+	}
+
+	/*
+	 * parses the whole stream, passing each token to out.write(token) (see lz77_sinks.h). Returns the number of phrases.
+	 */
+	template<class sink>
+	ulint parse(sink &out){
+
+		ulint phrases = 0;
+
+		while(not eof()){
+
+			token t = get_token();
+			out.write(t);
+
+			phrases++;
+
+		}
+
+		return phrases;
+
+	}
+
+	/*
+	 * save the state of the parse: dynamic BWT, position in the stream and the pending mismatching character (already read
+	 * from the stream, first character of the next phrase). The parse can be resumed with load.
+	 */
+	void saveToFile(string path){
+
+		FILE *fp;
+
+		if ((fp = fopen(path.c_str(), "wb")) == NULL) {
+			cout << "Cannot open file " << path << endl;
+			exit(1);
+		}
+
+		fwrite(&n, sizeof(ulint), 1, fp);
+		fwrite(&position, sizeof(ulint), 1, fp);
+		fwrite(&sigma, sizeof(uint), 1, fp);
+		fwrite(uchar_to_int.data(), sizeof(uint), 256, fp);
+		fwrite(&mismatching_character, sizeof(char), 1, fp);
+		fwrite(&window, sizeof(ulint), 1, fp);
+		fwrite(&removed, sizeof(ulint), 1, fp);
+
+		dbwt.saveToFile(fp);
+
+		fclose(fp);
+
+	}
+
+	/*
+	 * resume a parse saved with saveToFile. input is the stream being parsed, positioned at its beginning: the characters
+	 * already read by the saved parser are skipped (without parsing them).
+	 */
+	void load(std::istream & input, string path, bool verbose = false){
+
+		FILE *fp;
+
+		if ((fp = fopen(path.c_str(), "rb")) == NULL) {
+			cout << "Cannot open file " << path << endl;
+			exit(1);
+		}
+
+		ulint numBytes;
+
+		numBytes = fread(&n, sizeof(ulint), 1, fp);
+		assert(numBytes>0);
+		numBytes = fread(&position, sizeof(ulint), 1, fp);
+		assert(numBytes>0);
+		numBytes = fread(&sigma, sizeof(uint), 1, fp);
+		assert(numBytes>0);
+
+		uchar_to_int = vector<uint>(256);
+		numBytes = fread(uchar_to_int.data(), sizeof(uint), 256, fp);
+		assert(numBytes>0);
+
+		numBytes = fread(&mismatching_character, sizeof(char), 1, fp);
+		assert(numBytes>0);
+		numBytes = fread(&window, sizeof(ulint), 1, fp);
+		assert(numBytes>0);
+		numBytes = fread(&removed, sizeof(ulint), 1, fp);
+		assert(numBytes>0);
+
+		dbwt = dynamic_bwt_type();
+		dbwt.loadFromFile(fp);
+
+		fclose(fp);
+
+		this->input = &input;
+		this->verbose = verbose;
+		last_perc = (position*100)/std::max(n,(ulint)1);
+
+		//skip the characters already read (the mismatching character has been read from the stream)
+		ulint read = position + (mismatching_character!=0);
+
+		input.seekg(read, std::ios::cur);
+
+		if(input.fail()){//not seekable: read and discard
+
+			input.clear();
+			input.ignore(read);
+
+		}
+
+		numBytes++;//avoids "variable not used" warning
 
 	}
 
@@ -317,6 +463,30 @@ public:
 
 private:
 
+	//true if bitvector T has a member remove (needed by the windowed parse)
+	template<class T>
+	struct has_remove{
+
+		template<class U> static char test(decltype(&U::remove));
+		template<class U> static long test(...);
+
+		static const bool value = sizeof(test<T>(0))==1;
+
+	};
+
+	void slide_window(std::true_type){
+
+		while(dbwt.size()-1>window){
+
+			dbwt.remove_last();
+			removed++;
+
+		}
+
+	}
+
+	void slide_window(std::false_type){}//not reached: checked in the constructor
+
 	char read_char(){
 
 		char c=mismatching_character;
@@ -349,6 +519,9 @@ private:
 
 	char mismatching_character=0;//first character after previous read phrase
 
+	ulint window=0;//sliding window size (0 = whole stream)
+	ulint removed=0;//number of characters removed from the BWT (windowed mode)
+
 	bool verbose=false;
 
 	int last_perc=0;//for verbose output
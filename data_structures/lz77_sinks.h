@@ -0,0 +1,93 @@
+/*
+ *  This file is part of BWTIL.
+ *  Copyright (c) by
+ *  Nicola Prezza <nicolapr@gmail.com>
+ *
+ *   BWTIL is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+
+ *   BWTIL is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details (<http://www.gnu.org/licenses/>).
+ */
+
+//============================================================================
+// Name        : lz77_sinks.h
+// Author      : Nicola Prezza
+// Version     : 1.0
+
+/*
+ * Sinks for the tokens of lz77_parser (see lz77_parser::parse). A sink is any class with a method write(lz77_token &).
+ *
+ * - lz77_text_sink: one token per line: "(start_position,length)" for copies, "'c'" for the first occurrence of a character.
+ * - lz77_binary_sink: two 64-bit integers per token: <start_position, length> for copies, <c, 0> for the first occurrence
+ *   of a character c.
+ */
+//============================================================================
+
+#ifndef LZ77_SINKS_H_
+#define LZ77_SINKS_H_
+
+#include "../common/common.h"
+#include "lz77_parser.h"
+
+namespace bwtil {
+
+class lz77_text_sink {
+
+public:
+
+	lz77_text_sink(std::ostream & out){
+
+		this->out = &out;
+
+	}
+
+	void write(lz77_token &t){
+
+		if(t.start_position_is_defined)
+			(*out) << "(" << t.start_position << "," << t.length << ")\n";
+		else
+			(*out) << "'" << t.character << "'\n";
+
+	}
+
+private:
+
+	std::ostream * out = 0;
+
+};
+
+class lz77_binary_sink {
+
+public:
+
+	lz77_binary_sink(std::ostream & out){
+
+		this->out = &out;
+
+	}
+
+	void write(lz77_token &t){
+
+		ulint record[2];
+
+		record[0] = t.start_position_is_defined ? t.start_position : t.character;
+		record[1] = t.start_position_is_defined ? t.length : 0;
+
+		out->write((char *)record, sizeof(record));
+
+	}
+
+private:
+
+	std::ostream * out = 0;
+
+};
+
+} /* namespace bwtil */
+
+#endif /* LZ77_SINKS_H_ */
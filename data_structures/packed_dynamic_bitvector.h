@@ -0,0 +1,105 @@
+/*
+ *  This file is part of BWTIL.
+ *  Copyright (c) by
+ *  Nicola Prezza <nicolapr@gmail.com>
+ *
+ *   BWTIL is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+
+ *   BWTIL is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details (<http://www.gnu.org/licenses/>).
+ */
+
+//============================================================================
+// Name        : packed_dynamic_bitvector.h
+// Author      : Nicola Prezza
+// Version     : 1.0
+/*
+ * Description: dynamic bitvector with access, insert, remove, rank and access_rank (access and rank with one descent). It is a packed_dynamic_vector of 1-bit integers, so
+ * rank is the prefix sum (popcount on the leaves). Same interface of bitv (it can be used as dynamic_bitvector_type in
+ * DynamicString and DynamicBWT), plus remove: this is the bitvector used by the windowed LZ77 parser.
+ *
+ */
+
+#ifndef PACKED_DYNAMIC_BITVECTOR_H_
+#define PACKED_DYNAMIC_BITVECTOR_H_
+
+#include "../common/common.h"
+#include "packed_dynamic_vector.h"
+
+namespace bwtil {
+
+template<uint leaf_bits = W_leafs, uint degree = 64>
+class packed_dynamic_bitvector{
+
+public:
+
+	struct info_t{
+
+		ulint capacity;
+		ulint size;
+		ulint height;
+
+	};
+
+	packed_dynamic_bitvector(){}
+
+	/*
+	 * bitvector of maximum size n. The second parameter (node size) is unused: same constructor of bitv
+	 */
+	packed_dynamic_bitvector(ulint n, size_t = 0){
+
+		bits = packed_dynamic_vector<leaf_bits,degree>(n,1);
+
+	}
+
+	bool access(ulint i){return bits.get(i);}
+
+	bool operator[](ulint i){return bits.get(i);}
+
+	void insert(ulint i, bool b){bits.insert(i,b);}
+
+	//remove bit in position i. Returns the removed bit
+	bool remove(ulint i){return bits.remove(i);}
+
+	//number of bits equal to b in positions [0,i)
+	ulint rank(ulint i, bool b=true){
+
+		ulint r = bits.psum(i);
+
+		return b ? r : i-r;
+
+	}
+
+	//bit in position i and number of bits equal to it in positions [0,i), with one descent of the tree
+	pair<bool,ulint> access_rank(ulint i){
+
+		auto br = bits.get_psum(i);
+
+		return {br.first, br.first ? br.second : i-br.second};
+
+	}
+
+	ulint size(){return bits.size();}
+
+	info_t info(){return {bits.capacity(), bits.size(), bits.treeHeight()};}
+
+	void saveToFile(FILE *fp){bits.saveToFile(fp);}
+
+	void loadFromFile(FILE *fp){bits.loadFromFile(fp);}
+
+private:
+
+	packed_dynamic_vector<leaf_bits,degree> bits = packed_dynamic_vector<leaf_bits,degree>(ulint(1)<<40,1);
+
+};
+
+typedef packed_dynamic_bitvector<> packed_dynamic_bitvector_t;
+
+}//namespace bwtil
+
+#endif /* PACKED_DYNAMIC_BITVECTOR_H_ */
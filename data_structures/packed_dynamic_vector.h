@@ -0,0 +1,909 @@
+/*
+ *  This file is part of BWTIL.
+ *  Copyright (c) by
+ *  Nicola Prezza <nicolapr@gmail.com>
+ *
+ *   BWTIL is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+
+ *   BWTIL is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details (<http://www.gnu.org/licenses/>).
+ */
+
+//============================================================================
+// Name        : packed_dynamic_vector.h
+// Author      : Nicola Prezza
+// Version     : 1.0
+/*
+ * Description: a dynamic vector of fixed-width integers with access, insert, set, remove and prefix-sum operations. Same interface
+ * of dynamic_vector (it can be used as dynamic_vector_type in DynamicBWT and lz77_parser), but the integers are stored packed
+ * in the leaves of a B-tree: every operation costs one root-to-leaf descent, i.e. O(log n), instead of one descent per bit.
+ *
+ * Leaves contain at most leaf_bits bits (+ one word of slack); internal nodes have at most degree children. After a remove,
+ * underfull leaves/nodes are merged with (or borrow from) a sibling, and freed leaves/nodes are reused by the next inserts:
+ * the memory used is proportional to the current length of the vector.
+ *
+ */
+
+#ifndef PACKED_DYNAMIC_VECTOR_H_
+#define PACKED_DYNAMIC_VECTOR_H_
+
+#include "../common/common.h"
+
+namespace bwtil {
+
+template<uint leaf_bits = W_leafs, uint degree = 64>
+class packed_dynamic_vector{
+
+public:
+
+	/*
+	 * default constructor. Sets a large max length (2^40) and width=64 bits
+	 */
+	packed_dynamic_vector(){
+
+		init(ulint(1)<<40, 64);
+
+	}
+
+	/*
+	 * constructor with max length of the vector and integer width
+	 */
+	packed_dynamic_vector(ulint max_length, uint width){
+
+		init(max_length, width);
+
+	}
+
+	/*
+	 * get element in position i
+	 */
+	ulint const operator[](ulint i){
+
+		return get(i);
+
+	}
+
+	/*
+	 * get element in position i
+	 */
+	ulint get(ulint i){
+
+		assert(i<current_length);
+
+		uint id = root;
+
+		for(uint l=height;l>0;l--){
+
+			node &x = nodes[id];
+
+			uint c=0;
+			while(i>=x.sizes[c])
+				i -= x.sizes[c++];
+
+			id = x.children[c];
+
+		}
+
+		return getBits(leaves[id],i);
+
+	}
+
+	/*
+	 * insert integer w in position i
+	 */
+	void insert(ulint i, ulint w){
+
+		if(width<64)
+			assert(w<( ulint(1)<<width  ));
+
+		assert(current_length<max_length);
+		assert(i<=current_length);
+
+		lint sibling = insert(root, height, i, w);
+
+		if(sibling>=0){//the root has been split: new root with two children
+
+			node r;
+
+			r.children = {root, (uint)sibling};
+			r.sizes = {subtreeSize(root,height), subtreeSize(sibling,height)};
+			r.sums = {subtreeSum(root,height), subtreeSum(sibling,height)};
+
+			uint new_root = newNode();
+			nodes[new_root] = r;
+
+			root = new_root;
+			height++;
+
+		}
+
+		current_length++;
+
+	}
+
+	/*
+	 * remove the element in position i. Returns the removed element
+	 */
+	ulint remove(ulint i){
+
+		assert(i<current_length);
+
+		ulint w = remove(root, height, i);
+
+		//if the root has only one child, the child becomes the new root
+		while(height>0 and nodes[root].children.size()==1){
+
+			uint old_root = root;
+			root = nodes[root].children[0];
+			height--;
+
+			freeNode(old_root);
+
+		}
+
+		current_length--;
+
+		return w;
+
+	}
+
+	/*
+	 * set element in position i to w
+	 */
+	void set(ulint i, ulint w){
+
+		if(width<64)
+			assert(w<( ulint(1)<<width  ));
+
+		assert(i<current_length);
+
+		ulint delta = w-get(i);//modulo 2^64
+
+		uint id = root;
+
+		for(uint l=height;l>0;l--){
+
+			node &x = nodes[id];
+
+			uint c=0;
+			while(i>=x.sizes[c])
+				i -= x.sizes[c++];
+
+			x.sums[c] += delta;
+			id = x.children[c];
+
+		}
+
+		setBits(leaves[id],i,w);
+
+	}
+
+	/*
+	 * sum of the elements in positions [0,i) (modulo 2^64). With width=1, this is rank of bit 1
+	 */
+	ulint psum(ulint i){
+
+		assert(i<=current_length);
+
+		ulint sum=0;
+		uint id = descend(i,sum);
+
+		return sum + leafSum(leaves[id],i);
+
+	}
+
+	/*
+	 * element in position i and sum of the elements in positions [0,i), with one descent of the tree. With width=1, this
+	 * is access and rank of bit 1
+	 */
+	pair<ulint,ulint> get_psum(ulint i){
+
+		assert(i<current_length);
+
+		ulint sum=0;
+		uint id = descend(i,sum);
+
+		return {getBits(leaves[id],i), sum + leafSum(leaves[id],i)};
+
+	}
+
+	/*
+	 * height of the B-tree (0 = only one leaf)
+	 */
+	uint treeHeight(){return height;}
+
+	/*
+	 * current vector length
+	 */
+	ulint length(){return current_length;}
+	ulint size(){return current_length;}
+
+	/*
+	 * maximum number of elements that can be stored in the vector
+	 */
+	ulint capacity(){return max_length;}
+
+	/*
+	 * The file starts with a header (format version, leaf_bits, degree, width) checked by loadFromFile. Then the leaves
+	 * (all leaf sizes, then the words of each leaf), the internal nodes and the free lists. loadFromFile copies everything
+	 * in memory.
+	 */
+	void saveToFile(FILE *fp){
+
+		ulint number_of_leaves = leaves.size();
+		ulint number_of_nodes = nodes.size();
+		ulint leaf_words = emptyLeaf().words.size();
+
+		uint header[4] = {format_version, leaf_bits, degree, width};
+		fwrite(header, sizeof(uint), 4, fp);
+
+		fwrite(&max_length, sizeof(ulint), 1, fp);
+		fwrite(&current_length, sizeof(ulint), 1, fp);
+		fwrite(&leaf_capacity, sizeof(uint), 1, fp);
+		fwrite(&root, sizeof(uint), 1, fp);
+		fwrite(&height, sizeof(uint), 1, fp);
+		fwrite(&number_of_leaves, sizeof(ulint), 1, fp);
+		fwrite(&number_of_nodes, sizeof(ulint), 1, fp);
+		fwrite(&leaf_words, sizeof(ulint), 1, fp);
+
+		for(auto &l : leaves)
+			fwrite(&l.size, sizeof(uint), 1, fp);
+
+		for(auto &l : leaves)
+			fwrite(l.words.data(), sizeof(ulint), leaf_words, fp);
+
+		for(auto &x : nodes){
+
+			ulint k = x.children.size();
+
+			fwrite(&k, sizeof(ulint), 1, fp);
+
+			if(k>0){
+
+				fwrite(x.children.data(), sizeof(uint), k, fp);
+				fwrite(x.sizes.data(), sizeof(ulint), k, fp);
+				fwrite(x.sums.data(), sizeof(ulint), k, fp);
+
+			}
+
+		}
+
+		saveVector(free_leaves, fp);
+		saveVector(free_nodes, fp);
+
+	}
+
+	void loadFromFile(FILE *fp){
+
+		ulint numBytes;
+		ulint number_of_leaves;
+		ulint number_of_nodes;
+		ulint leaf_words;
+
+		uint header[4];
+
+		if(fread(header, sizeof(uint), 4, fp)!=4 or header[0]!=format_version){
+			cout << "Error while loading packed_dynamic_vector: unknown file format." << endl;
+			exit(1);
+		}
+
+		if(header[1]!=leaf_bits or header[2]!=degree){
+			cout << "Error while loading packed_dynamic_vector: the file has been saved with leaf_bits=" << header[1] << " and degree="
+				<< header[2] << ", but this instance has leaf_bits=" << leaf_bits << " and degree=" << degree << "." << endl;
+			exit(1);
+		}
+
+		width = header[3];
+
+		numBytes = fread(&max_length, sizeof(ulint), 1, fp);
+		assert(numBytes>0);
+		numBytes = fread(&current_length, sizeof(ulint), 1, fp);
+		assert(numBytes>0);
+		numBytes = fread(&leaf_capacity, sizeof(uint), 1, fp);
+		assert(numBytes>0);
+		numBytes = fread(&root, sizeof(uint), 1, fp);
+		assert(numBytes>0);
+		numBytes = fread(&height, sizeof(uint), 1, fp);
+		assert(numBytes>0);
+		numBytes = fread(&number_of_leaves, sizeof(ulint), 1, fp);
+		assert(numBytes>0);
+		numBytes = fread(&number_of_nodes, sizeof(ulint), 1, fp);
+		assert(numBytes>0);
+		numBytes = fread(&leaf_words, sizeof(ulint), 1, fp);
+		assert(numBytes>0);
+
+		if(width==0 or width>64 or leaf_capacity!=std::max(leaf_bits/width, (uint)4) or leaf_words!=emptyLeaf().words.size()){
+			cout << "Error while loading packed_dynamic_vector: inconsistent width (" << width << ") and leaf size." << endl;
+			exit(1);
+		}
+
+		leaves = vector<leaf>(number_of_leaves);
+
+		for(auto &l : leaves){
+
+			numBytes = fread(&l.size, sizeof(uint), 1, fp);
+			assert(numBytes>0);
+
+		}
+
+		for(auto &l : leaves){
+
+			l.words = vector<ulint>(leaf_words);
+			numBytes = fread(l.words.data(), sizeof(ulint), leaf_words, fp);
+			assert(numBytes>0);
+
+		}
+
+		nodes = vector<node>(number_of_nodes);
+
+		for(auto &x : nodes){
+
+			ulint k;
+
+			numBytes = fread(&k, sizeof(ulint), 1, fp);
+			assert(numBytes>0);
+
+			x.children = vector<uint>(k);
+			x.sizes = vector<ulint>(k);
+			x.sums = vector<ulint>(k);
+
+			if(k>0){
+
+				numBytes = fread(x.children.data(), sizeof(uint), k, fp);
+				assert(numBytes>0);
+				numBytes = fread(x.sizes.data(), sizeof(ulint), k, fp);
+				assert(numBytes>0);
+				numBytes = fread(x.sums.data(), sizeof(ulint), k, fp);
+				assert(numBytes>0);
+
+			}
+
+		}
+
+		free_leaves = loadVector(fp);
+		free_nodes = loadVector(fp);
+
+		numBytes++;//avoids "variable not used" warning
+
+	}
+
+private:
+
+	struct leaf{
+
+		vector<ulint> words;//elements packed in width bits each, element k in bits [k*width, (k+1)*width)
+		uint size=0;//number of elements
+
+	};
+
+	struct node{
+
+		vector<uint> children;//indexes in leaves (if the node is at height 1) or in nodes
+		vector<ulint> sizes;//number of elements in each subtree
+		vector<ulint> sums;//sum of the elements in each subtree
+
+	};
+
+	void init(ulint max_length, uint width){
+
+		assert(width>0 and width<=64);
+
+		this->width=width;
+		this->max_length=max_length;
+
+		leaf_capacity = std::max(leaf_bits/width, (uint)4);
+
+		leaves = vector<leaf>(1,emptyLeaf());
+		nodes = vector<node>();
+
+		free_leaves = vector<uint>();
+		free_nodes = vector<uint>();
+
+		root=0;
+		height=0;
+		current_length=0;
+
+	}
+
+	leaf emptyLeaf(){
+
+		leaf l;
+		l.words = vector<ulint>( (leaf_capacity*width)/64 + 2, 0 );
+
+		return l;
+
+	}
+
+	static void saveVector(vector<uint> &v, FILE *fp){
+
+		ulint size = v.size();
+
+		fwrite(&size, sizeof(ulint), 1, fp);
+
+		if(size>0)
+			fwrite(v.data(), sizeof(uint), size, fp);
+
+	}
+
+	static vector<uint> loadVector(FILE *fp){
+
+		ulint size;
+		ulint numBytes = fread(&size, sizeof(ulint), 1, fp);
+		assert(numBytes>0);
+
+		vector<uint> v(size);
+
+		if(size>0){
+
+			numBytes = fread(v.data(), sizeof(uint), size, fp);
+			assert(numBytes>0);
+
+		}
+
+		numBytes++;//avoids "variable not used" warning
+
+		return v;
+
+	}
+
+	//index of an empty leaf (a freed one, if any)
+	uint newLeaf(){
+
+		if(free_leaves.size()==0){
+
+			leaves.push_back(emptyLeaf());
+			return leaves.size()-1;
+
+		}
+
+		uint id = free_leaves.back();
+		free_leaves.pop_back();
+
+		leaves[id].size=0;
+
+		return id;
+
+	}
+
+	//index of an empty internal node (a freed one, if any)
+	uint newNode(){
+
+		if(free_nodes.size()==0){
+
+			nodes.push_back(node());
+			return nodes.size()-1;
+
+		}
+
+		uint id = free_nodes.back();
+		free_nodes.pop_back();
+
+		return id;
+
+	}
+
+	void freeLeaf(uint id){
+
+		leaves[id].size=0;
+		free_leaves.push_back(id);
+
+	}
+
+	void freeNode(uint id){
+
+		nodes[id] = node();
+		free_nodes.push_back(id);
+
+	}
+
+	/*
+	 * descends to the leaf containing position i (the last leaf if i=current_length). Returns the leaf; i becomes the
+	 * position in the leaf and the sum of the elements before the leaf is added to sum
+	 */
+	uint descend(ulint &i, ulint &sum){
+
+		uint id = root;
+
+		for(uint l=height;l>0;l--){
+
+			node &x = nodes[id];
+
+			uint c=0;
+			while(c<x.children.size()-1 and i>=x.sizes[c]){
+
+				sum += x.sums[c];
+				i -= x.sizes[c++];
+
+			}
+
+			id = x.children[c];
+
+		}
+
+		return id;
+
+	}
+
+	//sum of the first k elements of the leaf
+	ulint leafSum(leaf &l, uint k){
+
+		ulint sum=0;
+
+		if(width==1){
+
+			for(uint j=0;j<k/64;j++)
+				sum += popcnt(l.words[j]);
+
+			if(k%64>0)
+				sum += popcnt(l.words[k/64] & ((ulint(1)<<(k%64))-1));
+
+			return sum;
+
+		}
+
+		for(uint j=0;j<k;j++)
+			sum += getBits(l,j);
+
+		return sum;
+
+	}
+
+	inline ulint getBits(leaf &l, uint k){return readBits(l.words, ulint(k)*width, width);}
+
+	inline void setBits(leaf &l, uint k, ulint value){writeBits(l.words, ulint(k)*width, width, value);}
+
+	//the len<=64 bits starting at bit p
+	static inline ulint readBits(vector<ulint> &words, ulint p, uint len){
+
+		ulint word = p/64;
+		uint offset = p%64;
+
+		ulint value = words[word] >> offset;
+
+		if(offset+len>64)
+			value |= words[word+1] << (64-offset);
+
+		return len==64 ? value : value & ((ulint(1)<<len)-1);
+
+	}
+
+	//writes value in the len<=64 bits starting at bit p
+	static inline void writeBits(vector<ulint> &words, ulint p, uint len, ulint value){
+
+		ulint word = p/64;
+		uint offset = p%64;
+
+		ulint mask = len==64 ? ~ulint(0) : (ulint(1)<<len)-1;
+
+		words[word] = (words[word] & ~(mask<<offset)) | (value<<offset);
+
+		if(offset+len>64){
+
+			uint written = 64-offset;
+			words[word+1] = (words[word+1] & ~(mask>>written)) | (value>>written);
+
+		}
+
+	}
+
+	/*
+	 * copies len bits from bit sp of src to bit dp of dst, 64 bits at a time. src and dst can be the same vector: the
+	 * copy direction is chosen so that overlapping ranges are handled correctly.
+	 */
+	static void copyBits(vector<ulint> &src, ulint sp, vector<ulint> &dst, ulint dp, ulint len){
+
+		if(&src==&dst and dp>sp){
+
+			//right shift: copy from the end
+			while(len>0){
+
+				uint l = std::min(len,(ulint)64);
+				len -= l;
+
+				writeBits(dst, dp+len, l, readBits(src, sp+len, l));
+
+			}
+
+			return;
+
+		}
+
+		for(ulint done=0;done<len;){
+
+			uint l = std::min(len-done,(ulint)64);
+
+			writeBits(dst, dp+done, l, readBits(src, sp+done, l));
+
+			done += l;
+
+		}
+
+	}
+
+	ulint subtreeSize(uint id, uint h){
+
+		if(h==0)
+			return leaves[id].size;
+
+		ulint s=0;
+		for(auto x : nodes[id].sizes)
+			s += x;
+
+		return s;
+
+	}
+
+	ulint subtreeSum(uint id, uint h){
+
+		if(h==0)
+			return leafSum(leaves[id],leaves[id].size);
+
+		ulint s=0;
+		for(auto x : nodes[id].sums)
+			s += x;
+
+		return s;
+
+	}
+
+	/*
+	 * inserts w in position i of the subtree rooted in id (at height h). If the subtree root has been split, returns the
+	 * index of its new right sibling, otherwise -1.
+	 */
+	lint insert(uint id, uint h, ulint i, ulint w){
+
+		if(h==0){
+
+			leaf &l = leaves[id];
+
+			//shift elements [i,size) one position to the right
+			copyBits(l.words, ulint(i)*width, l.words, ulint(i+1)*width, ulint(l.size-i)*width);
+
+			setBits(l,i,w);
+			l.size++;
+
+			if(l.size<leaf_capacity)
+				return -1;
+
+			//split the leaf: upper half goes to a new leaf
+			uint r = newLeaf();
+
+			moveElements(id, leaves[id].size/2, leaves[id].size, r, 0);
+
+			return r;
+
+		}
+
+		uint c=0;
+		{
+			node &x = nodes[id];
+
+			while(c<x.children.size()-1 and i>x.sizes[c])
+				i -= x.sizes[c++];
+
+			x.sizes[c]++;
+			x.sums[c] += w;
+		}
+
+		lint sibling = insert(nodes[id].children[c], h-1, i, w);
+
+		if(sibling<0)
+			return -1;
+
+		//child c has been split: insert the new child after it
+		{
+			node &x = nodes[id];
+
+			uint child = x.children[c];
+
+			x.children.insert(x.children.begin()+c+1, (uint)sibling);
+			x.sizes.insert(x.sizes.begin()+c+1, subtreeSize(sibling,h-1));
+			x.sizes[c] = subtreeSize(child,h-1);
+
+			x.sums.insert(x.sums.begin()+c+1, subtreeSum(sibling,h-1));
+			x.sums[c] = subtreeSum(child,h-1);
+
+			if(x.children.size()<=degree)
+				return -1;
+		}
+
+		//split the node: upper half of the children goes to a new node
+		uint r = newNode();
+
+		moveChildren(id, nodes[id].children.size()/2, nodes[id].children.size(), r, 0);
+
+		return r;
+
+	}
+
+	/*
+	 * removes the element in position i of the subtree rooted in id (at height h) and returns it. The children of id may be
+	 * rebalanced, but id itself may become underfull: this is fixed by its parent.
+	 */
+	ulint remove(uint id, uint h, ulint i){
+
+		if(h==0){
+
+			leaf &l = leaves[id];
+
+			ulint w = getBits(l,i);
+
+			//shift elements (i,size) one position to the left
+			copyBits(l.words, ulint(i+1)*width, l.words, ulint(i)*width, ulint(l.size-i-1)*width);
+
+			l.size--;
+
+			return w;
+
+		}
+
+		uint c=0;
+		{
+			node &x = nodes[id];
+
+			while(i>=x.sizes[c])
+				i -= x.sizes[c++];
+		}
+
+		ulint w = remove(nodes[id].children[c], h-1, i);
+
+		nodes[id].sizes[c]--;
+		nodes[id].sums[c] -= w;
+
+		if(underfull(nodes[id].children[c], h-1) and nodes[id].children.size()>1)
+			rebalance(id, h, c);
+
+		return w;
+
+	}
+
+	bool underfull(uint id, uint h){
+
+		if(h==0)
+			return leaves[id].size < leaf_capacity/4;
+
+		return nodes[id].children.size() < std::max(degree/4,(uint)2);
+
+	}
+
+	/*
+	 * child c of node id (at height h) is underfull: merge it with a sibling or, if the result would be too large,
+	 * redistribute evenly the content of the two siblings.
+	 */
+	void rebalance(uint id, uint h, uint c){
+
+		uint a = (c+1<nodes[id].children.size() ? c : c-1);//merge children a and a+1
+
+		uint left = nodes[id].children[a];
+		uint right = nodes[id].children[a+1];
+
+		if(h==1){
+
+			uint total = leaves[left].size + leaves[right].size;
+
+			if(total<leaf_capacity){
+
+				moveElements(right, 0, leaves[right].size, left, leaves[left].size);
+				freeLeaf(right);
+
+			}else if(leaves[left].size < total/2){
+
+				moveElements(right, 0, total/2-leaves[left].size, left, leaves[left].size);
+
+			}else{
+
+				moveElements(left, total/2, leaves[left].size, right, 0);
+
+			}
+
+		}else{
+
+			uint total = nodes[left].children.size() + nodes[right].children.size();
+
+			if(total<=degree){
+
+				moveChildren(right, 0, nodes[right].children.size(), left, nodes[left].children.size());
+				freeNode(right);
+
+			}else if(nodes[left].children.size() < total/2){
+
+				moveChildren(right, 0, total/2-nodes[left].children.size(), left, nodes[left].children.size());
+
+			}else{
+
+				moveChildren(left, total/2, nodes[left].children.size(), right, 0);
+
+			}
+
+		}
+
+		node &x = nodes[id];
+
+		if(h==1 ? leaves[right].size==0 : nodes[right].children.size()==0){//right has been merged into left
+
+			x.children.erase(x.children.begin()+a+1);
+			x.sizes.erase(x.sizes.begin()+a+1);
+			x.sums.erase(x.sums.begin()+a+1);
+
+		}else{
+
+			x.sizes[a+1] = subtreeSize(right,h-1);
+			x.sums[a+1] = subtreeSum(right,h-1);
+
+		}
+
+		x.sizes[a] = subtreeSize(left,h-1);
+		x.sums[a] = subtreeSum(left,h-1);
+
+	}
+
+	/*
+	 * moves the elements in positions [begin,end) of leaf src to position pos of leaf dst (src and dst are adjacent leaves:
+	 * either begin=0 and the elements are appended to dst, or end=size of src and the elements are prepended to dst)
+	 */
+	void moveElements(uint src, uint begin, uint end, uint dst, uint pos){
+
+		leaf &s = leaves[src];
+		leaf &d = leaves[dst];
+
+		uint k = end-begin;
+
+		//make room in dst
+		copyBits(d.words, ulint(pos)*width, d.words, ulint(pos+k)*width, ulint(d.size-pos)*width);
+
+		copyBits(s.words, ulint(begin)*width, d.words, ulint(pos)*width, ulint(k)*width);
+
+		d.size += k;
+
+		//close the gap in src
+		copyBits(s.words, ulint(end)*width, s.words, ulint(begin)*width, ulint(s.size-end)*width);
+
+		s.size -= k;
+
+	}
+
+	//as moveElements, for the children of internal nodes
+	void moveChildren(uint src, uint begin, uint end, uint dst, uint pos){
+
+		node &s = nodes[src];
+		node &d = nodes[dst];
+
+		d.children.insert(d.children.begin()+pos, s.children.begin()+begin, s.children.begin()+end);
+		d.sizes.insert(d.sizes.begin()+pos, s.sizes.begin()+begin, s.sizes.begin()+end);
+		d.sums.insert(d.sums.begin()+pos, s.sums.begin()+begin, s.sums.begin()+end);
+
+		s.children.erase(s.children.begin()+begin, s.children.begin()+end);
+		s.sizes.erase(s.sizes.begin()+begin, s.sizes.begin()+end);
+		s.sums.erase(s.sums.begin()+begin, s.sums.begin()+end);
+
+	}
+
+	static const uint format_version = 1;//version of the file format of saveToFile
+
+	uint width=64;
+	ulint max_length=0;
+	ulint current_length=0;
+
+	uint leaf_capacity=0;//max number of elements in a leaf
+
+	vector<leaf> leaves;
+	vector<node> nodes;//internal nodes
+
+	vector<uint> free_leaves;//removed leaves and nodes, reused by newLeaf() and newNode()
+	vector<uint> free_nodes;
+
+	uint root=0;//index of the root in leaves (if height=0) or in nodes
+	uint height=0;
+
+};
+
+typedef packed_dynamic_vector<> packed_dynamic_vector_t;
+
+}//namespace bwtil
+
+#endif /* PACKED_DYNAMIC_VECTOR_H_ */
@@ -29,7 +29,8 @@
 
 #include "IndexedBWT.h"
 #include "FileReader.h"
-#include "../algorithms/cw_bwt.h"
+#include "SequenceFileReader.h"
+#include "../algorithms/bwt_builder.h"
 
 namespace bwtil {
 
@@ -37,21 +38,81 @@ class succinctFMIndex {
 
 public:
 
+	/*
+	 * iterates over the occurrences of a pattern, locating them one at a time (in BWT order).
+	 * The iterator keeps a pointer to the index: do not use it after the index is destroyed or moved.
+	 */
+	class occurrence_iterator{
+
+	public:
+
+		occurrence_iterator(IndexedBWT * idxBWT, pair<ulint, ulint> interval){
+
+			this->idxBWT = idxBWT;
+			this->interval = interval;
+
+			position = interval.first;
+
+		}
+
+		bool hasNext(){return position<interval.second;};
+
+		//locate next occurrence. Returns 0 if there are no more occurrences
+		ulint next(){
+
+			if(not hasNext())
+				return 0;
+
+			return idxBWT->convertToTextCoordinate(position++);
+
+		}
+
+		//total number of occurrences (located or not)
+		ulint numberOfOccurrences(){return interval.second-interval.first;};
+
+	private:
+
+		IndexedBWT * idxBWT;
+		pair<ulint, ulint> interval;//interval on the BWT
+
+		ulint position;//position on the BWT of the next occurrence to be located
+
+	};
+
 	succinctFMIndex(){};
 
-	succinctFMIndex(string text, ulint n, bool verbose= false){
+	/*
+	 * qgram_budget = max number of bytes used by the table of q-gram intervals (q is chosen automatically).
+	 * If 0, the table is not built.
+	 */
+	succinctFMIndex(string text, ulint n, bool verbose= false, ulint qgram_budget = 0){
 
 		build(text,verbose);
+		initQgramTable(qgram_budget,verbose);
 
 	}
 
-	succinctFMIndex(string path, bool verbose= false){
+	//mode = file_path (raw text file) or sequence_file_path (sequences of a FASTA/FASTQ/2-bit file, see SequenceFile.h)
+	succinctFMIndex(string path, bool verbose= false, ulint qgram_budget = 0, input_mode mode = file_path){
+
+		string text;
+
+		if(mode==sequence_file_path){
+
+			SequenceFileReader fr(path,verbose);
+			text = fr.toString();
+			fr.close();
 
-		FileReader fr = FileReader(path);
-		string text = fr.toString();
-		fr.close();
+		}else{
+
+			FileReader fr = FileReader(path);
+			text = fr.toString();
+			fr.close();
+
+		}
 
 		build(text,verbose);
+		initQgramTable(qgram_budget,verbose);
 
 	}
 
@@ -65,13 +126,54 @@ public:
 
 	ulint size(){//returns size of the structure in bits
 
-		return idxBWT.size();
+		return idxBWT.size() + qgram_table.size()*qgram_table.width() + short_rows.size()*64;
+
+	}
+
+	/*
+	 * backward search: returns interval <lower_included, upper_excluded> of P on the BWT.
+	 * If the q-gram table is present and |P|>=q, the search starts from the interval of the last q characters of P.
+	 */
+	pair<ulint, ulint> BS(string &P){
+
+		if(q==0 or P.length()<q)
+			return idxBWT.BS(P);
+
+		return idxBWT.BS(P, P.length()-q, qgramInterval(P, P.length()-q));
 
 	}
 
 	vector<ulint> getOccurrencies(string P){
 
-		return idxBWT.convertToTextCoordinates( idxBWT.BS(P) );
+		return idxBWT.convertToTextCoordinates( BS(P) );
+
+	}
+
+	//returns number of occurrences of P in the text. Only backward search is performed (no locate)
+	ulint count(string P){
+
+		pair<ulint, ulint> interval = BS(P);
+
+		return interval.second - interval.first;
+
+	}
+
+	//returns first 'limit' occurrences (in BWT order) of P in the text. If limit=0, all occurrences are returned
+	vector<ulint> locate(string P, ulint limit=0){
+
+		pair<ulint, ulint> interval = BS(P);
+
+		if(limit>0 and interval.second-interval.first>limit)//truncate interval
+			interval.second = interval.first+limit;
+
+		return idxBWT.convertToTextCoordinates( interval );
+
+	}
+
+	//returns an iterator that locates the occurrences of P lazily
+	occurrence_iterator getOccurrenceIterator(string P){
+
+		return occurrence_iterator(&idxBWT, BS(P));
 
 	}
 
@@ -112,6 +214,21 @@ public:
 
 		idxBWT.saveToFile(fp);
 
+		//q-gram table (q=0 if absent)
+		fwrite(&q, sizeof(ulint), 1, fp);
+
+		if(q>0){
+
+			ulint short_rows_size = short_rows.size();
+
+			fwrite(&qgram_table_size, sizeof(ulint), 1, fp);
+			fwrite(&short_rows_size, sizeof(ulint), 1, fp);
+			fwrite(short_rows.data(), sizeof(ulint), short_rows_size, fp);
+
+			save_packed_view_to_file(qgram_table,qgram_table_size,fp);
+
+		}
+
 	}
 
 	void loadFromFile(FILE *fp){
@@ -129,6 +246,27 @@ public:
 
 		idxBWT.loadFromFile(fp);
 
+		//indexes built before the q-gram table was introduced end here
+		if(fread(&q, sizeof(ulint), 1, fp)==0)
+			q=0;
+
+		if(q>0){
+
+			ulint short_rows_size;
+
+			numBytes = fread(&qgram_table_size, sizeof(ulint), 1, fp);
+			assert(numBytes>0);
+			numBytes = fread(&short_rows_size, sizeof(ulint), 1, fp);
+			assert(numBytes>0);
+
+			short_rows = vector<ulint>(short_rows_size);
+			numBytes = fread(short_rows.data(), sizeof(ulint), short_rows_size, fp);
+			assert(numBytes>0);
+
+			qgram_table = load_packed_view_from_file(intlog2(idxBWT.length()),qgram_table_size,fp);
+
+		}
+
 		numBytes++;//avoids "variable not used" warning
 
 	}
@@ -143,6 +281,8 @@ public:
 
 	ulint textLength(){return n;};
 
+	ulint qgramLength(){return q;};//0 if the q-gram table is not present
+
 private:
 
 	void build(string text, bool verbose= false){
@@ -156,8 +296,7 @@ private:
 		{
 
 			if(verbose) cout << " Computing the BWT ... " << flush;
-			auto cwbwt = cw_bwt(text,cw_bwt::text,true);
-			bwt = cwbwt.toString();
+			bwt = bwt_builder::toString(text,cw_bwt::text,true);
 			if(verbose) cout << "done." << endl;
 
 		}
@@ -186,6 +325,114 @@ private:
 
 	}
 
+	/*
+	 * choose the largest q such that the table (sigma^q entries of log(n+1) bits) fits in 'budget' bytes and q <= log_sigma n,
+	 * then fill the table with a single scan (n LF steps) of the BWT.
+	 */
+	void initQgramTable(ulint budget, bool verbose){
+
+		q = 0;
+
+		if(budget==0)
+			return;
+
+		ulint bwt_length = idxBWT.length();
+		ulint base = idxBWT.alphabetSize();
+		uint width = intlog2(bwt_length);//entries are in {0,...,bwt_length}
+
+		ulint size = 1;
+		ulint q_candidate = 0;
+
+		if(base>1)
+			while( (size*base*width)/8 <= budget and size*base <= bwt_length ){
+
+				size *= base;
+				q_candidate++;
+
+			}
+
+		if(q_candidate<2){
+
+			if(verbose) cout << " Memory budget too small for the q-gram table: table not built." << endl;
+			return;
+
+		}
+
+		q = q_candidate;
+		qgram_table_size = size;
+
+		if(verbose) cout << " Building q-gram table with q = " << q << " (" << qgram_table_size << " entries) ... " << flush;
+
+		ulint empty = bwt_length;
+
+		qgram_table = packed_view_t(width,qgram_table_size);
+		for(ulint i=0;i<qgram_table_size;i++)
+			qgram_table[i] = empty;
+
+		short_rows = vector<ulint>();
+
+		//navigate the text backwards. At each step, code is the q-gram prefixing the suffix in BWT row j
+		ulint msd = qgram_table_size/base;//weight of the most significant digit
+		ulint code = 0;
+		ulint j = 0;//row of the suffix containing only the terminator
+
+		short_rows.push_back(j);
+
+		for(ulint l=1;l<bwt_length;l++){//l = number of text characters in the suffix of row LF(j)
+
+			uchar c = idxBWT.at(j);
+
+			j = idxBWT.LF(j);
+			code = code/base + idxBWT.remap(c)*msd;
+
+			if(l<q)
+				short_rows.push_back(j);
+			else if(j < qgram_table[code])
+				qgram_table[code] = j;
+
+		}
+
+		std::sort(short_rows.begin(),short_rows.end());
+
+		//empty q-grams point to the next nonempty q-gram
+		for(ulint i=qgram_table_size-1;i>=1;i--)
+			if(qgram_table[i-1] == empty)
+				qgram_table[i-1] = qgram_table.get(i);
+
+		if(verbose) cout << "done." << endl;
+
+	}
+
+	//interval of the q-gram P[start,...,start+q-1] on the BWT
+	pair<ulint, ulint> qgramInterval(string &P, ulint start){
+
+		ulint base = idxBWT.alphabetSize();
+		ulint code = 0;
+
+		for(ulint i=start;i<start+q;i++){
+
+			uchar c = (uchar)P.at(i);
+
+			if(not idxBWT.inAlphabet(c))
+				return pair<ulint, ulint>(0,0);
+
+			code = code*base + idxBWT.remap(c);
+
+		}
+
+		pair<ulint, ulint> interval(qgram_table.get(code), idxBWT.length());
+
+		if(code+1<qgram_table_size)
+			interval.second = qgram_table.get(code+1);
+
+		//rows of suffixes shorter than q fall between the intervals of two consecutive q-grams: exclude them
+		while(interval.second>interval.first and std::binary_search(short_rows.begin(),short_rows.end(),interval.second-1))
+			interval.second--;
+
+		return interval;
+
+	}
+
 	IndexedBWT idxBWT;
 	ulint n;//text length (excluded terminator character 0x0)
 
@@ -194,6 +441,11 @@ private:
 
 	ulint offrate;
 
+	ulint q=0;//length of the q-grams in the q-gram table. 0 = no table
+	ulint qgram_table_size=0;//sigma^q
+	packed_view_t qgram_table;//qgram_table[x] = first BWT row prefixed by the q-gram x (q-grams are numbers in base sigma)
+	vector<ulint> short_rows;//sorted BWT rows of the q suffixes having less than q text characters
+
 };
 
 } /* namespace bwtil */
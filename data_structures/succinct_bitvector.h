@@ -21,8 +21,17 @@
 // Description :
 
  /*
- *   This class implements a bitvector with constant time support for rank and access queries
- *   space occupancy = n + n/word_length^2 * log n + n/word_length * log word_length^2 (word_length=64)
+ *   This class implements a bitvector with constant time support for rank and access queries, and
+ *   sampled select queries.
+ *
+ *   Rank counters are interleaved with the bits (rank9 layout, Vigna 2008): every block of 512 bits is stored in 10 consecutive
+ *   words: the absolute number of 1s before the block, 7 relative 9-bit counters (one for each word of the block but the first)
+ *   and the 8 words of bits. A rank query therefore touches only one block (at most 2 cache lines) instead of 3 separate vectors.
+ *
+ *   select1/select0 store the block containing every select_rate-th 1/0 and finish with a binary search on the
+ *   block counters, a scan of the relative counters and a select inside one word.
+ *
+ *   space occupancy = n + n/4 + 2*(n/select_rate)*64 bits
  */
 
 //============================================================================
@@ -61,6 +70,8 @@ public:
 		global_rank1=0;
 		local_rank1=0;
 
+		data.reserve( (vb.size()/block_bits + 1)*block_words );
+
 		for(ulint i=0;i<vb.size();i++)
 			push_back(vb.at(i));
 
@@ -75,6 +86,13 @@ public:
 		if(n%word_length==0)
 			updateVectors();
 
+		//the bit being inserted is the (k*select_rate)-th 1 (or 0): sample its block
+		if(b and global_rank1%select_rate==0)
+			select_samples_1.push_back(n/block_bits);
+
+		if(not b and (n-global_rank1)%select_rate==0)
+			select_samples_0.push_back(n/block_bits);
+
 		global_rank1 += b;
 		local_rank1 += b;
 
@@ -89,7 +107,7 @@ public:
 	*/
 	ulint size(){
 
-		return bitvector.size()*word_length + rank_ptrs_1.size()*word_length + rank_ptrs_2.size()*16;
+		return data.size()*word_length + (select_samples_1.size()+select_samples_0.size())*word_length;
 
 	}
 
@@ -110,24 +128,23 @@ public:
 	//number of 1's before position i (excluded) in the bitvector
 	inline ulint rank1(ulint i){
 
-		ulint current_word = i/word_length;
-		ulint remainder = i%word_length;
-
 		if(i==n){
-			assert(global_rank1<n);
+			assert(global_rank1<=n);
 			return global_rank1;
 		}
 
-		assert(i<=n);
-		assert(i/(word_length_2)<rank_ptrs_1.size());
-		assert(current_word<rank_ptrs_2.size());
-		assert(current_word<bitvector.size());
+		assert(i<n);
 
-		uint pop = 0;
-		if(remainder>0)
-			pop = popcnt( bitvector[current_word] >> ( word_length - remainder ) );
+		ulint block = (i/block_bits)*block_words;
+		ulint w = (i%block_bits)/word_length;
+		ulint remainder = i%word_length;
+
+		assert(block+2+w<data.size());
+
+		ulint rank1 = data[block] + relativeRank(block,w);
 
-		ulint rank1 = rank_ptrs_1[i/word_length_2] + rank_ptrs_2[current_word] + pop;
+		if(remainder>0)
+			rank1 += popcnt( data[block+2+w] >> ( word_length - remainder ) );
 
 		assert(rank1<=i);
 
@@ -152,46 +169,139 @@ public:
 
 		assert(i<n);
 
-		return ( bitvector[i/word_length] >> ( (word_length-1) - (i%word_length) ) ) & ((ulint)1);
+		return ( data[ (i/block_bits)*block_words + 2 + (i%block_bits)/word_length ] >> ( (word_length-1) - (i%word_length) ) ) & ((ulint)1);
+
+	}
+
+	/*
+	 * argument: integer i < numberOf1()
+	 * returns: position of the i-th 1 in the bitvector. i starts from 0
+	 */
+	ulint select1(ulint i){
+
+		assert(i<global_rank1);
+
+		//blocks [lo,hi] contain the i-th 1
+		ulint lo = select_samples_1[i/select_rate];
+		ulint hi = (i/select_rate+1 < select_samples_1.size() ? select_samples_1[i/select_rate+1] : numberOfBlocks()-1);
+
+		//last block with less than i+1 ones before it
+		while(lo<hi){
+
+			ulint mid = (lo+hi+1)/2;
+
+			if(data[mid*block_words] <= i)
+				lo = mid;
+			else
+				hi = mid-1;
+
+		}
+
+		ulint block = lo*block_words;
+		i -= data[block];
+
+		ulint w = 0;
+		while(w+1<words_per_block and relativeRank(block,w+1) <= i)
+			w++;
+
+		i -= relativeRank(block,w);
+
+		return lo*block_bits + w*word_length + selectInWord(data[block+2+w],i);
+
+	}
+
+	/*
+	 * argument: integer i < numberOf0()
+	 * returns: position of the i-th 0 in the bitvector. i starts from 0
+	 */
+	ulint select0(ulint i){
+
+		assert(i<n-global_rank1);
+
+		ulint lo = select_samples_0[i/select_rate];
+		ulint hi = (i/select_rate+1 < select_samples_0.size() ? select_samples_0[i/select_rate+1] : numberOfBlocks()-1);
+
+		while(lo<hi){
+
+			ulint mid = (lo+hi+1)/2;
+
+			if(mid*block_bits - data[mid*block_words] <= i)
+				lo = mid;
+			else
+				hi = mid-1;
+
+		}
+
+		ulint block = lo*block_words;
+		i -= lo*block_bits - data[block];
+
+		ulint w = 0;
+		while(w+1<words_per_block and (w+1)*word_length - relativeRank(block,w+1) <= i)
+			w++;
+
+		i -= w*word_length - relativeRank(block,w);
+
+		//bits beyond position n are 0 in memory but are never selected, since i < numberOf0()
+		return lo*block_bits + w*word_length + selectInWord(~data[block+2+w],i);
+
+	}
+
+	/*
+	 * argument: integer i, boolean b
+	 * returns: position of the i-th bit equal to b. i starts from 0
+	 */
+	ulint select(ulint i, bool b=true){
+
+		return b ? select1(i) : select0(i);
 
 	}
 
 	void saveToFile(FILE *fp){
 
-		ulint rank_ptrs_1_size = rank_ptrs_1.size();
-		ulint rank_ptrs_2_size = rank_ptrs_2.size();
-		ulint bitvector_size = bitvector.size();
+		ulint data_size = data.size();
+		ulint select_samples_1_size = select_samples_1.size();
+		ulint select_samples_0_size = select_samples_0.size();
+
+		uint64_t tag = format_tag;
 
+		fwrite(&tag, sizeof(uint64_t), 1, fp);
 		fwrite(&n, sizeof(ulint), 1, fp);
-		fwrite(&rank_ptrs_1_size, sizeof(ulint), 1, fp);
-		fwrite(&rank_ptrs_2_size, sizeof(ulint), 1, fp);
-		fwrite(&bitvector_size, sizeof(ulint), 1, fp);
+		fwrite(&data_size, sizeof(ulint), 1, fp);
+		fwrite(&select_samples_1_size, sizeof(ulint), 1, fp);
+		fwrite(&select_samples_0_size, sizeof(ulint), 1, fp);
 		fwrite(&global_rank1, sizeof(uint64_t), 1, fp);
 		fwrite(&local_rank1, sizeof(uint16_t), 1, fp);
 
-		if(rank_ptrs_1_size>0) fwrite(rank_ptrs_1.data(), sizeof(uint64_t), rank_ptrs_1_size, fp);
-		if(rank_ptrs_2_size>0) fwrite(rank_ptrs_2.data(), sizeof(uint16_t), rank_ptrs_2_size, fp);
-		if(bitvector_size>0) fwrite(bitvector.data(), sizeof(uint64_t), bitvector_size, fp);
+		if(data_size>0) fwrite(data.data(), sizeof(uint64_t), data_size, fp);
+		if(select_samples_1_size>0) fwrite(select_samples_1.data(), sizeof(uint64_t), select_samples_1_size, fp);
+		if(select_samples_0_size>0) fwrite(select_samples_0.data(), sizeof(uint64_t), select_samples_0_size, fp);
 
 	}
 
 	void loadFromFile(FILE *fp){
 
 		ulint numBytes;
-		ulint rank_ptrs_1_size;
-		ulint rank_ptrs_2_size;
-		ulint bitvector_size;
+		ulint data_size;
+		ulint select_samples_1_size;
+		ulint select_samples_0_size;
+		uint64_t tag;
+
+		//files written before the rank9 layout start directly with n
+		if(fread(&tag, sizeof(uint64_t), 1, fp)!=1 or tag!=format_tag){
+			cout << "Error: the index has been built with an older version of BWTIL (different bitvector format). Please rebuild the index." << endl;
+			exit(1);
+		}
 
 		numBytes = fread(&n, sizeof(ulint), 1, fp);
 		assert(numBytes>0);
 
-		numBytes = fread(&rank_ptrs_1_size, sizeof(ulint), 1, fp);
+		numBytes = fread(&data_size, sizeof(ulint), 1, fp);
 		assert(numBytes>0);
 
-		numBytes = fread(&rank_ptrs_2_size, sizeof(ulint), 1, fp);
+		numBytes = fread(&select_samples_1_size, sizeof(ulint), 1, fp);
 		assert(numBytes>0);
 
-		numBytes = fread(&bitvector_size, sizeof(ulint), 1, fp);
+		numBytes = fread(&select_samples_0_size, sizeof(ulint), 1, fp);
 		assert(numBytes>0);
 
 		numBytes = fread(&global_rank1, sizeof(uint64_t), 1, fp);
@@ -200,22 +310,22 @@ public:
 		numBytes = fread(&local_rank1, sizeof(uint16_t), 1, fp);
 		assert(numBytes>0);
 
-		rank_ptrs_1 = vector<uint64_t>(rank_ptrs_1_size,0);
-		rank_ptrs_2 = vector<uint16_t>(rank_ptrs_2_size,0);
-		bitvector = vector<uint64_t>(bitvector_size,0);
+		data = vector<uint64_t>(data_size,0);
+		select_samples_1 = vector<uint64_t>(select_samples_1_size,0);
+		select_samples_0 = vector<uint64_t>(select_samples_0_size,0);
 
-		if(rank_ptrs_1_size>0){
-			numBytes = fread(rank_ptrs_1.data(), sizeof(uint64_t), rank_ptrs_1_size, fp);
+		if(data_size>0){
+			numBytes = fread(data.data(), sizeof(uint64_t), data_size, fp);
 			assert(numBytes>0);
 		}
 
-		if(rank_ptrs_2_size>0){
-			numBytes = fread(rank_ptrs_2.data(), sizeof(uint16_t), rank_ptrs_2_size, fp);
+		if(select_samples_1_size>0){
+			numBytes = fread(select_samples_1.data(), sizeof(uint64_t), select_samples_1_size, fp);
 			assert(numBytes>0);
 		}
 
-		if(bitvector_size>0){
-			numBytes = fread(bitvector.data(), sizeof(uint64_t), bitvector_size, fp);
+		if(select_samples_0_size>0){
+			numBytes = fread(select_samples_0.data(), sizeof(uint64_t), select_samples_0_size, fp);
 			assert(numBytes>0);
 		}
 
@@ -233,53 +343,99 @@ public:
 
 private:
 
+	//number of 1s in the block starting at data[block] before word w of the block (w<words_per_block)
+	inline ulint relativeRank(ulint block, ulint w){
+
+		//counter of word 0 is implicitly 0: shift out everything
+		return w==0 ? 0 : ( data[block+1] >> (9*(w-1)) ) & 511;
+
+	}
+
+	//position (from the most significant bit) of the i-th 1 in x. i starts from 0
+	inline uint selectInWord(uint64_t x, ulint i){
+
+		uint pos = 0;
+
+		//skip whole bytes
+		uint pop;
+		while( (pop = popcnt( x >> (word_length-8-pos) & 255 )) <= i ){
+
+			i -= pop;
+			pos += 8;
+
+		}
+
+		//bit by bit in the byte
+		while(true){
+
+			if( (x >> (word_length-1-pos)) & ((ulint)1) ){
+
+				if(i==0)
+					return pos;
+
+				i--;
+
+			}
+
+			pos++;
+
+		}
+
+	}
+
+	ulint numberOfBlocks(){return data.size()/block_words;}
+
 	//called before inserting a bit in a position i multiple of word_length
 	void updateVectors(){
 
-		if(n%word_length_2==0){
-			rank_ptrs_1.push_back(global_rank1);
+		if(n%block_bits==0){
+
+			//new block: absolute counter, relative counters, 8 words of bits.
+			//relative counters of words not yet started are 511, so that select never ends up in them
+			data.push_back(global_rank1);
+			data.push_back( (((uint64_t)1)<<63)-1 );
+			data.insert(data.end(),words_per_block,0);
 			local_rank1=0;
-		}
 
-		rank_ptrs_2.push_back(local_rank1);
+		}else{
 
-		bitvector.push_back(0);
+			//store relative counter of the new word
+			ulint w = (n%block_bits)/word_length;
+			data[ (n/block_bits)*block_words + 1 ] &= ~( ((uint64_t)511) << (9*(w-1)) );
+			data[ (n/block_bits)*block_words + 1 ] |= ((uint64_t)local_rank1) << (9*(w-1));
+
+		}
 
 	}
 
 	//insert bit at the end (position n)
 	inline void insert(bool b){
 
-		//current word is the one at the end of bitvector
+		//current word is word (n%block_bits)/word_length of the last block
 		//position in the word is n%word_length
 		//moreover, insert bit only if it is 1 (otherwise nothing changes)
 
-		if(b){
-
-			bitvector[ bitvector.size()-1 ] |= ( ((ulint)1) << ( (word_length - 1) - (n%word_length)) );
-
-			//if((global_rank1-1)%word_length_2 == 0)
-				//sampled_select.push_back(rank_ptrs_1.size()-1);
-
-		}
+		if(b)
+			data[ (n/block_bits)*block_words + 2 + (n%block_bits)/word_length ] |= ( ((ulint)1) << ( (word_length - 1) - (n%word_length)) );
 
 	}
 
-
+	static const uint64_t format_tag = 0x42575449524b3901;//first word written by saveToFile (rank9 layout, version 1)
 
 	ulint n=0;//length of the bitvector
 
-	vector<uint64_t> bitvector;//the bits are stored in a vector, so that they can be accessed in blocks of size word_length
-	vector<uint64_t> rank_ptrs_1;//rank pointers sampled every word_length^2 positions
-	vector<uint16_t> rank_ptrs_2;//rank pointers sampled every word_length positions
-	//vector<uint64_t> sampled_select;//pointer to rank_ptrs_1 every word_length^2 ones
-
+	vector<uint64_t> data;//interleaved blocks: [absolute rank, 7 relative ranks, 8 words of bits]
+	vector<uint64_t> select_samples_1;//block containing the (k*select_rate)-th 1, for each k
+	vector<uint64_t> select_samples_0;//block containing the (k*select_rate)-th 0, for each k
 
 	uint64_t global_rank1=0;//rank1 up to position n excluded
-	uint16_t local_rank1=0;//rank1 up to position n excluded from beginning of current block of size word_length^2
+	uint16_t local_rank1=0;//rank1 up to position n excluded from beginning of current block of size block_bits
 
 	static constexpr uint word_length = 64;//size of words
-	static constexpr ulint word_length_2 = word_length*word_length;//square of size of words
+	static constexpr uint words_per_block = 8;//words of bits in a block
+	static constexpr ulint block_bits = words_per_block*word_length;//bits in a block
+	static constexpr ulint block_words = words_per_block+2;//words in a block (2 words of counters)
+	static constexpr ulint select_rate = 4096;//one select sample every select_rate 1s (0s)
 
 };
 
@@ -0,0 +1,90 @@
+/*
+ *  This file is part of BWTIL.
+ *  Copyright (c) by
+ *  Nicola Prezza <nicolapr@gmail.com>
+ *
+ *   BWTIL is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+
+ *   BWTIL is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details (<http://www.gnu.org/licenses/>).
+ */
+
+/*
+ * bwt-benchmark.cpp
+ *
+ *  Description: compares the BWT construction engines (cw_bwt and sa_bwt) on prefixes of increasing length of a text file.
+ */
+
+#include "../../algorithms/bwt_builder.h"
+
+using namespace bwtil;
+
+ int main(int argc,char** argv) {
+
+#ifdef DEBUG
+	 cout << "\n ****** DEBUG MODE ******\n\n";
+#endif
+
+	if(argc != 2 and argc != 3){
+		cout << "*** BWT construction benchmark ***\n";
+		cout << "Compares the compressed-space engine (cw_bwt) and the parallel suffix sorting engine (sa_bwt) on prefixes of\n";
+		cout << "length 1MB, 2MB, 4MB, ... of the input text file (and on the whole file). Outputs of the two engines are compared.\n";
+		cout << "Usage: bwt-benchmark text_file [threads]\n";
+		cout << "where:\n";
+		cout << "- text_file is the input text file. Input file must not contain a 0x0 byte since the algorithms use it as text terminator.\n";
+		cout << "- threads (optional) is the number of threads used by sa_bwt. Default: all hardware threads.\n";
+		exit(0);
+	}
+
+    using std::chrono::high_resolution_clock;
+    using std::chrono::duration_cast;
+    using std::chrono::duration;
+
+	uint threads = 0;
+	if(argc==3)
+		threads = atoi(argv[2]);
+
+	FileReader fr(argv[1]);
+	string text = fr.toString();
+	fr.close();
+
+	vector<ulint> sizes;
+	for(ulint len = 1<<20; len < text.length(); len *= 2)
+		sizes.push_back(len);
+	sizes.push_back(text.length());
+
+	cout << "length (bytes)\tcw_bwt (s)\tsa_bwt (s)\tspeedup\tsa_bwt RAM (MB)\tautomatic choice" << endl;
+
+	for(auto len : sizes){
+
+		string prefix = text.substr(0,len);
+
+		auto t1 = high_resolution_clock::now();
+		string bwt_cw = cw_bwt(prefix,cw_bwt::text,false).toString();
+		auto t2 = high_resolution_clock::now();
+		string bwt_sa = sa_bwt(prefix,cw_bwt::text,false,threads).toString();
+		auto t3 = high_resolution_clock::now();
+
+		double time_cw = duration_cast<duration<double, std::ratio<1>>>(t2 - t1).count();
+		double time_sa = duration_cast<duration<double, std::ratio<1>>>(t3 - t2).count();
+
+		if(bwt_cw.compare(bwt_sa)!=0){
+
+			cout << "Error: the two engines produced different BWTs on a prefix of length " << len << endl;
+			exit(1);
+
+		}
+
+		cout << len << "\t" << time_cw << "\t" << time_sa << "\t" << (time_sa>0 ? time_cw/time_sa : 0) << "\t"
+			 << sa_bwt::memoryRequirement(len)/(1<<20) << "\t"
+			 << (bwt_builder::chooseEngine(len)==bwt_builder::suffix_sorting ? "sa_bwt" : "cw_bwt") << endl;
+
+	}
+
+ }
+
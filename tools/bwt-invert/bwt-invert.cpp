@@ -23,25 +23,130 @@
 
 #include "../../data_structures/IndexedBWT.h"
 #include "../../data_structures/FileReader.h"
+#include <thread>
+#include <atomic>
 
 using namespace bwtil;
 
+/*
+ * parallel inversion. Rows multiple of 'step' (row 0 included) are the starting points of the chains: each chain walks the BWT
+ * backwards (LF) from its starting row until it reaches the starting row of another chain, storing the (reversed) text segment
+ * between the two rows. The LF permutation is a single cycle, so the chains partition the text; their order in the text is given
+ * by following, from the chain starting at row 0 (text end), the row where each chain stops.
+ *
+ * no pre-pass is needed: the chains are independent and are distributed dynamically among the threads.
+ */
+void invertParallel(IndexedBWT &idxBWT, ulint n_inv_bwt, uint threads, FILE * fp){
+
+	ulint n_bwt = idxBWT.length();
+
+	//many chains per thread: chain lengths are uneven, dynamic scheduling balances the load
+	ulint step = n_bwt/(threads*64);
+	if(step==0) step=1;
+
+	ulint number_of_chains = (n_bwt+step-1)/step;
+
+	vector<string> segments(number_of_chains);//segment of each chain, in reverse text order
+	vector<ulint> next_chain(number_of_chains);//chain reached by each chain (i.e. chain preceding it in the text)
+
+	std::atomic<ulint> chain_counter(0);
+	std::atomic<ulint> chars_done(0);
+
+	auto worker = [&](){
+
+		ulint s;
+		while((s = chain_counter++) < number_of_chains){
+
+			ulint j = s*step;
+			string &seg = segments[s];
+
+			do{
+
+				uchar c = idxBWT.at(j);
+
+				if(c!=0)//skip the terminator
+					seg.push_back(c);
+
+				j = idxBWT.LF(j);
+
+			}while(j%step != 0);
+
+			next_chain[s] = j/step;
+			chars_done += seg.length();
+
+		}
+
+	};
+
+	vector<std::thread> pool;
+	for(uint t=0;t<threads;t++)
+		pool.push_back(std::thread(worker));
+
+	for(auto &t : pool)
+		t.join();
+
+	if(chars_done != n_inv_bwt){
+		cout << "Error: inverted " << chars_done << " characters instead of " << n_inv_bwt << ". Check input BWT file.\n";
+		exit(1);
+	}
+
+	//order of the chains from text end to text beginning
+	vector<ulint> order;
+	order.reserve(number_of_chains);
+
+	ulint s = 0;
+	do{
+
+		order.push_back(s);
+		s = next_chain[s];
+
+		if(order.size()>number_of_chains){//prevents loop in case of errors in the BWT
+			cout << "Error: loop while scanning BWT. Check input BWT file.\n";
+			exit(1);
+		}
+
+	}while(s!=0);
+
+	//write segments from text beginning to text end
+	for(ulint i=order.size();i>0;i--){
+
+		string &seg = segments[order[i-1]];
+		std::reverse(seg.begin(),seg.end());
+
+		fwrite(seg.data(), sizeof(uchar), seg.length(), fp);
+
+		string().swap(seg);//free memory
+
+	}
+
+}
+
  int main(int argc,char** argv) {
 
 #ifdef DEBUG
 	 cout << "\n ****** DEBUG MODE ******\n\n";
 #endif
 
-	if(argc != 3){
+	if(argc != 3 and not (argc == 5 and string(argv[3]).compare("-t")==0)){
 		cout << "*** BWT invert ***\n";
 		cout << "Given a bwt file, invert it to reconstruct original text file.\n";
-		cout << "Usage: bwt-invert bwt_file output_text_file\n";
+		cout << "Usage: bwt-invert bwt_file output_text_file [-t threads]\n";
 		cout << "where:\n";
 		cout <<	"- bwt_file is a valid bwt of some text file, with a 0x0 byte as terminator character (must appear only once in the bwt!).\n";
 		cout <<	"- output_text_file is inverted bwt produced by bwt-inverter (without the 0x0 terminator)\n";
+		cout <<	"- threads (optional, default 1) is the number of threads inverting the BWT in parallel\n";
 		exit(0);
 	}
 
+	uint threads = 1;
+	if(argc == 5)
+		threads = atoi(argv[4]);
+
+	if(threads==0){
+		cout << "Error: number of threads must be at least 1\n";
+		exit(1);
+	}
+
     using std::chrono::high_resolution_clock;
     using std::chrono::duration_cast;
     using std::chrono::duration;
@@ -66,44 +171,56 @@ using namespace bwtil;
 
     }
 
-	cout << "\nDone. Inverting the BWT ... " << endl;
+	FILE * fp;
+	if ((fp = fopen(argv[2], "wb")) == NULL) {
+		VERBOSE_CHANNEL<< "Cannot open file "  << argv[2] <<endl;
+		exit(1);
+	}
+
+	if(threads>1){
+
+		cout << "\nDone. Inverting the BWT with " << threads << " threads ... " << endl;
+
+		invertParallel(idxBWT, n_inv_bwt, threads, fp);
+
+		fclose(fp);
+
+	}else{
+
+		cout << "\nDone. Inverting the BWT ... " << endl;
 
-	string inverted_bwt = string(n_inv_bwt,'e');//without text terminator 0x0
+		string inverted_bwt = string(n_inv_bwt,'e');//without text terminator 0x0
 
-	//invert the bwt
+		//invert the bwt
 
-	ulint i=0;//number of steps
-	ulint bwt_pos=0;//position in the L column of the BWT.
+		ulint i=0;//number of steps
+		ulint bwt_pos=0;//position in the L column of the BWT.
 
-	int perc, last_perc=-1;
+		int perc, last_perc=-1;
 
-	while(i<n_inv_bwt){
+		while(i<n_inv_bwt){
 
-		inverted_bwt[n_inv_bwt-i-1] = idxBWT.at(bwt_pos);
-		bwt_pos = idxBWT.LF(bwt_pos);
-		i++;
+			inverted_bwt[n_inv_bwt-i-1] = idxBWT.at(bwt_pos);
+			bwt_pos = idxBWT.LF(bwt_pos);
+			i++;
 
-		perc = (i*100)/(n_inv_bwt-1);
-		if(perc>last_perc and perc%10==0){
+			perc = (i*100)/(n_inv_bwt-1);
+			if(perc>last_perc and perc%10==0){
 
-			cout << perc << "% done"<<endl;
-			last_perc=perc;
+				cout << perc << "% done"<<endl;
+				last_perc=perc;
+
+			}
 
 		}
 
-	}
+		cout << "\nDone. Saving the inverted BWT to file ... " << endl;
 
-	cout << "\nDone. Saving the inverted BWT to file ... " << endl;
+		fwrite(inverted_bwt.data(), sizeof(uchar), n_inv_bwt, fp);
+		fclose(fp);
 
-	FILE * fp;
-	if ((fp = fopen(argv[2], "wb")) == NULL) {
-		VERBOSE_CHANNEL<< "Cannot open file "  << argv[2] <<endl;
-		exit(1);
 	}
 
-	fwrite(inverted_bwt.data(), sizeof(uchar), n_inv_bwt, fp);
-	fclose(fp);
-
 	cout << "Done. Inverted BWT saved in " << argv[2] << endl;
 
 	printRSSstat();
@@ -23,24 +23,240 @@
 
 #include "../../data_structures/IndexedBWT.h"
 #include "../../data_structures/FileReader.h"
+#include "../../data_structures/SuffixArrayFile.h"
 
 using namespace bwtil;
 
+//maximum number of temporary files open at the same time in linear mode
+const ulint max_open_buckets = 256;
+
+/*
+ * calls f(row, text position) for all pairs stored in the temporary file 'path' or, if path is empty, for all rows of the
+ * BWT with a single LF traversal (n steps, rows visited in decreasing text position order).
+ */
+template<typename function>
+void forEachPair(IndexedBWT &idxBWT, ulint n_bwt, string path, ulint buffer_pairs, function f){
+
+	if(path.length()==0){
+
+		int perc,last_perc=-1;
+
+		ulint j=0;//row of the terminator suffix (text position n_bwt-1)
+		for(ulint i=n_bwt;i>0;i--){
+
+			f(j,i-1);
+			j = idxBWT.LF(j);
+
+			perc=(100*(n_bwt-i+1))/n_bwt;
+
+			if(perc>last_perc and perc%10==0){
+
+				cout << perc << "% done"<<endl;
+				last_perc=perc;
+
+			}
+
+		}
+
+		return;
+
+	}
+
+	FILE *tmp;
+	if ((tmp = fopen(path.c_str(), "rb")) == NULL) {
+		VERBOSE_CHANNEL<< "Cannot open file "  << path <<endl;
+		exit(1);
+	}
+
+	vector<ulint> pairs(2*buffer_pairs);
+
+	ulint numRead;
+	while((numRead = fread(pairs.data(), sizeof(ulint), pairs.size(), tmp)) > 0)
+		for(ulint k=0;k+1<numRead;k+=2)
+			f(pairs[k],pairs[k+1]);
+
+	fclose(tmp);
+	remove(path.c_str());
+
+}
+
+/*
+ * writes to the output the SA values of buckets [b0,b1), whose pairs <row, text position> are read from 'path' (or
+ * generated with the LF traversal if path is empty). A range with more than one bucket is first distributed in at most
+ * max_open_buckets groups of consecutive buckets (one temporary file each), then each group is processed recursively.
+ */
+void processBuckets(IndexedBWT &idxBWT, ulint n_bwt, ulint ram_budget, ulint bucket_rows, ulint b0, ulint b1, string path, string out_path, SuffixArrayFileWriter &sa_writer){
+
+	//pairs read at once from a temporary file: half of the budget (the other half is for the SA values or the group buffers)
+	ulint read_pairs = std::max((ram_budget/2)/(2*sizeof(ulint)),(ulint)1);
+
+	if(b1-b0==1){
+
+		ulint first_row = b0*bucket_rows;
+		ulint rows = std::min(bucket_rows, n_bwt-first_row);
+
+		vector<ulint> SA(rows);
+
+		forEachPair(idxBWT, n_bwt, path, read_pairs, [&](ulint row, ulint pos){SA[row-first_row] = pos;});
+
+		//row 0 (terminator) is not stored in the output
+		if(b0==0)
+			sa_writer.write(SA.data()+1, rows-1);
+		else
+			sa_writer.write(SA.data(), rows);
+
+		return;
+
+	}
+
+	ulint number_of_groups = std::min(b1-b0, max_open_buckets);
+	ulint group_size = (b1-b0+number_of_groups-1)/number_of_groups;//buckets per group
+	number_of_groups = (b1-b0+group_size-1)/group_size;
+
+	//the group buffers share half of the budget
+	ulint buffer_pairs = std::max((ram_budget/2)/(2*sizeof(ulint)*number_of_groups),(ulint)1);
+
+	vector<string> tmp_paths(number_of_groups);
+	vector<FILE*> tmp_files(number_of_groups);
+	vector<vector<ulint> > buffers(number_of_groups);//interleaved pairs <row, text position>
+
+	for(ulint g=0;g<number_of_groups;g++){
+
+		ulint g0 = b0+g*group_size;
+		tmp_paths[g] = out_path + ".tmp" + std::to_string(g0) + "_" + std::to_string(std::min(g0+group_size,b1));
+
+		if ((tmp_files[g] = fopen(tmp_paths[g].c_str(), "wb")) == NULL) {
+			VERBOSE_CHANNEL<< "Cannot open file "  << tmp_paths[g] <<endl;
+			exit(1);
+		}
+
+		buffers[g].reserve(2*buffer_pairs);
+
+	}
+
+	if(path.length()==0)
+		cout << "Scattering SA values in " << number_of_groups << " temporary files ... " << endl;
+
+	forEachPair(idxBWT, n_bwt, path, read_pairs, [&](ulint row, ulint pos){
+
+		ulint g = (row/bucket_rows-b0)/group_size;
+
+		buffers[g].push_back(row);
+		buffers[g].push_back(pos);
+
+		if(buffers[g].size()==2*buffer_pairs){
+
+			fwrite(buffers[g].data(), sizeof(ulint), buffers[g].size(), tmp_files[g]);
+			buffers[g].clear();
+
+		}
+
+	});
+
+	for(ulint g=0;g<number_of_groups;g++){
+
+		fwrite(buffers[g].data(), sizeof(ulint), buffers[g].size(), tmp_files[g]);
+		fclose(tmp_files[g]);
+
+	}
+
+	vector<vector<ulint> >().swap(buffers);
+
+	for(ulint g=0;g<number_of_groups;g++){
+
+		ulint g0 = b0+g*group_size;
+		processBuckets(idxBWT, n_bwt, ram_budget, bucket_rows, g0, std::min(g0+group_size,b1), tmp_paths[g], out_path, sa_writer);
+
+	}
+
+}
+
+/*
+ * linear-time SA reconstruction: a single LF traversal of the BWT (n steps) visits all rows in decreasing text position order.
+ * Pairs <row, text position> are scattered into buckets of consecutive rows; each bucket fits in 'ram_budget' bytes. Buckets are
+ * buffered in RAM and spilled to temporary files (at most max_open_buckets open at the same time: with more buckets, pairs are
+ * distributed to groups of buckets and the group files are split again); at the end each bucket is loaded, its SA values are
+ * placed in a RAM array, and the array is appended to the output file.
+ */
+void buildSALinear(IndexedBWT &idxBWT, ulint n_bwt, ulint ram_budget, string out_path, SuffixArrayFileWriter &sa_writer){
+
+	//half of the budget for the SA values of one bucket, half for the buffers
+	ulint bucket_rows = (ram_budget/2)/sizeof(ulint);
+	if(bucket_rows==0) bucket_rows=1;
+
+	ulint number_of_buckets = (n_bwt+bucket_rows-1)/bucket_rows;
+
+	cout << "Number of buckets = " << number_of_buckets << endl << endl;
+
+	processBuckets(idxBWT, n_bwt, ram_budget, bucket_rows, 0, number_of_buckets, string(), out_path, sa_writer);
+
+}
+
  int main(int argc,char** argv) {
 
 #ifdef DEBUG
 	 cout << "\n ****** DEBUG MODE ******\n\n";
 #endif
 
-	if(argc != 3 and argc != 4){
+	bool linear = false;
+	ulint ram_budget=0;
+	int offset_arg = 0;//0 = default
+	sa_format format = sa_legacy;
+	bool bad_args = argc < 3;
+
+	for(int a=3;a<argc and not bad_args;a++){
+
+		string arg(argv[a]);
+
+		if(arg.compare("-l")==0 and a+1<argc){
+
+			linear = true;
+
+			if(atoi(argv[++a])<=0){
+				cout << "Error: RAM_MB must be > 0.\n";
+				exit(1);
+			}
+
+			ram_budget = ((ulint)atoi(argv[a]))<<20;
+
+		}else if(arg.compare("-p")==0){
+
+			format = sa_packed;
+
+		}else if(arg.compare("-b")==0){
+
+			format = sa_bytes;
+
+		}else if(a==3 and arg[0]!='-'){
+
+			offset_arg = atoi(argv[3]);
+
+			if(offset_arg<=0){
+				cout << "Error: offset must be > 0.\n";
+				exit(1);
+			}
+
+		}else{
+
+			bad_args = true;
+
+		}
+
+	}
+
+	if(bad_args){
 		cout << "*** BWT to Suffix Array converter ***\n";
 		cout << "Given a bwt file, builds the Suffix array and stores it directly to disk.\n";
-		cout << "Format of ouput file is one unsigned long int for each text position. Size of the output file is therefore 8n Bytes.\n";
-		cout << "Usage: bwt-to-sa bwt_file output_sa_file [offset]\n";
+		cout << "By default, the ouput file contains one unsigned long int for each text position. Size of the output file is therefore 8n Bytes.\n";
+		cout << "Usage: bwt-to-sa bwt_file output_sa_file [offset | -l RAM_MB] [-p | -b]\n";
 		cout << "where:\n";
 		cout <<	"- bwt_file must be a valid bwt of some text file, with a 0x0 byte as terminator character (must appear only once in the bwt!)\n";
 		cout <<	"- output_sa_file is the output SA file.\n";
 		cout <<	"- offset (optional). Store explicitly one SA pointer every offset positions of the text. Default: log n/log sigma\n";
+		cout <<	"- -l RAM_MB (optional). Linear time: a single traversal of the BWT, with SA values scattered in temporary files\n";
+		cout <<	"  (in the same directory of output_sa_file) so that at most RAM_MB megabytes of SA values are kept in RAM.\n";
+		cout <<	"- -p (optional). Packed output: header + ceil(log2 n) bits per SA entry.\n";
+		cout <<	"- -b (optional). Byte-aligned output: header + ceil(log2 n)/8 bytes per SA entry (e.g. 5 bytes for n < 2^40).\n";
 		exit(0);
 	}
 
@@ -61,9 +277,11 @@ using namespace bwtil;
 
 		cout << "Indexing the BWT ... " << endl << endl;
 
+		if(linear){//no SA samples: the SA is reconstructed with a single BWT traversal
 
+			idxBWT = IndexedBWT(bwt,0,true);
 
-		if(argc==3){//auto bufsize
+		}else if(offset_arg==0){//auto bufsize
 
 			uint offset = log2(n_bwt)/8;
 			if(offset==0)
@@ -73,12 +291,7 @@ using namespace bwtil;
 
 		}else{// bufsize provided
 
-			if(atoi(argv[3])<=0){
-				cout << "Error: offset must be > 0.\n";
-				exit(1);
-			}
-
-			idxBWT = IndexedBWT(bwt,atoi(argv[3]),true);
+			idxBWT = IndexedBWT(bwt,offset_arg,true);
 
 		}
 
@@ -86,42 +299,46 @@ using namespace bwtil;
 
 	cout << "\nDone.\n\nStoring suffix array to file ... " << endl <<endl;
 
-	FILE *fp;
+	//the terminator suffix is not stored: n_bwt-1 entries
+	SuffixArrayFileWriter sa_writer(argv[2], n_bwt-1, format);
 
-	if ((fp = fopen(argv[2], "wb")) == NULL) {
-		VERBOSE_CHANNEL<< "Cannot open file "  << argv[2] <<endl;
-		exit(1);
-	}
+	if(linear){
 
-	int perc,last_perc=-1;
-	for(ulint i=1;i<n_bwt;i++){
+		buildSALinear(idxBWT, n_bwt, ram_budget, string(argv[2]), sa_writer);
 
-		ulint idx = idxBWT.convertToTextCoordinate(i);
+	}else{
 
-		if(idx>=n_bwt-1){
+		int perc,last_perc=-1;
+		for(ulint i=1;i<n_bwt;i++){
 
-			cout << "Error: SA address greater than text length. " << idx << ">=" << n_bwt-1 << endl;
-			cout << "Debug needed.\n";
-			exit(1);
+			ulint idx = idxBWT.convertToTextCoordinate(i);
 
-		}
+			if(idx>=n_bwt-1){
+
+				cout << "Error: SA address greater than text length. " << idx << ">=" << n_bwt-1 << endl;
+				cout << "Debug needed.\n";
+				exit(1);
 
-		fwrite(&idx, sizeof(ulint), 1, fp);
+			}
 
-		perc=(100*(i+1))/n_bwt;
+			sa_writer.write(idx);
 
-		if(perc>last_perc and perc%10==0){
+			perc=(100*(i+1))/n_bwt;
 
-			cout << perc << "% done"<<endl;
-			last_perc=perc;
+			if(perc>last_perc and perc%10==0){
+
+				cout << perc << "% done"<<endl;
+				last_perc=perc;
+
+			}
 
 		}
 
 	}
 
-	cout << "\nDone. Suffix array stored in " << argv[2] << endl;
+	sa_writer.close();
 
-	fclose(fp);
+	cout << "\nDone. Suffix array stored in " << argv[2] << " (" << sa_writer.bitsPerEntry() << " bits per entry)" << endl;
 
 	printRSSstat();
 
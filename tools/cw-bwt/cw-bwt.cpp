@@ -36,6 +36,7 @@ using namespace bwtil;
 		cout << "Usage: cw-bwt text_file bwt_file [k]\n";
 		cout << "where:\n";
 		cout << "- text_file is the input text file. Input file must not contain a 0x0 byte since the algorithm uses it as text terminator.\n";
+		cout << "  Files with extension .fa/.fasta/.fna/.fq/.fastq/.2bit (optionally .gz) are read as sequence files: the text is the concatenation of their sequences.\n";
 		cout << "- bwt_file is the output bwt file. This output file will contain a 0x0 terminator and thus will be 1 byte longer than the input file.\n";
 		cout << "- k (automatically detected if not specified) is the entropy order (context length).\n";
 		cout << "WARNING: for high values of k, the memory requirements approach n log n. If you specify k, choose it carefully!\n";
@@ -71,14 +72,17 @@ using namespace bwtil;
 
 	//build bwt from a text file:
 
+	string path(argv[1]);
+
+	//cw_bwt::path means that the first argument has to be interpreted as a file path rather than a text string.
+	//cw_bwt::sequence_path: FASTA/FASTQ/2-bit file (recognized by extension), only the sequences are read
+	cw_bwt::cw_bwt_input_type input_type = SequenceFile::isSequenceFile(path) ? cw_bwt::sequence_path : cw_bwt::path;
+
 	if(argc==3){//k autodetected
-		string path(argv[1]);
-		//cw_bwt::path means that the first argument has to be interpreted as a file path rather than a text string
-		cwbwt = cw_bwt(path,cw_bwt::path,true);
+		cwbwt = cw_bwt(path,input_type,true);
 	}
 	if(argc==4){//the user has specified k
-		string path(argv[1]);
-		cwbwt = cw_bwt(path,cw_bwt::path,atoi(argv[3]),true);
+		cwbwt = cw_bwt(path,input_type,atoi(argv[3]),true);
 	}
 	/*
 	 * If, instead, you want to compute the bwt of a string, create a cw_bwt object as follows:
@@ -23,6 +23,8 @@
 //============================================================================
 
 #include <iostream>
+#include <thread>
+#include <atomic>
 
 #include "../../data_structures/succinct_bitvector.h"
 #include "../../data_structures/DBhash.h"
@@ -39,22 +41,18 @@ using namespace std;
  */
 DBhash buildFromFile(string text_path, uint m){
 
-	// 1) read text from file
-
-	FileReader fr = FileReader(text_path);
-	//ulint n = fr.size();
-	string text = fr.toString();
-	fr.close();
-
-	// 2) create the hash function
+	// 1) create the hash function
 
 	//hash function for DNA search. Use only if the file is on the alphabet {A,C,G,T,N}
 	//n is the file length
 
+	//FASTA/FASTQ/2-bit files (recognized by extension) are read directly: only their sequences are indexed
+	input_mode mode = SequenceFile::isSequenceFile(text_path) ? sequence_file_path : file_path;
+
 	//general purpose hash function: detect automatically alphabet size
-	HashFunction h = HashFunction(m,text_path,true);
+	HashFunction h = HashFunction(m,text_path,true,mode);
 
-	//other hash functions (uncomment also n variable above)
+	//other hash functions (n = text length)
 
 	//bisulfite search (ACTGN alphabet, identifies C=T and G=A)
 	//HashFunction h = HashFunction(n,m,BS_SEARCH);
@@ -64,23 +62,269 @@ DBhash buildFromFile(string text_path, uint m){
 
 	//build dBhash data structure
 
-	//offrate=16, verbose=true
-	DBhash dBhash = DBhash(text,h,16,true);
+	//the text is streamed from disk (it is never loaded entirely in RAM). offrate=16, verbose=true
+	DBhash dBhash = DBhash(text_path,mode,h,16,true);
 
 	return dBhash;
 
+}
+
+/*
+ * input: path of a pattern file. Format is detected from the first character: '>' = FASTA, '@' = FASTQ, otherwise
+ * one pattern per line.
+ * returns: pairs <name,pattern>. In plain files, the name of a pattern is its line number (starting from 1)
+ */
+vector<pair<string,string> > readPatterns(string path){
+
+	std::ifstream in(path.c_str());
+
+	if(not in.is_open()){
+		VERBOSE_CHANNEL<< "Cannot open file "  << path <<endl;
+		exit(1);
+	}
+
+	vector<pair<string,string> > patterns;
+
+	string line;
+	ulint line_nr=0;
+
+	bool fasta=false;
+
+	while(std::getline(in,line)){
+
+		line_nr++;
+
+		if(line.length()>0 and line[line.length()-1]=='\r')
+			line.erase(line.length()-1);
+
+		if(line.length()==0)
+			continue;
+
+		if(line[0]=='>'){//FASTA header: the sequence can span multiple lines
+
+			fasta=true;
+			patterns.push_back(pair<string,string>(line.substr(1),""));
+
+		}else if(fasta){
+
+			patterns.back().second.append(line);
+
+		}else if(line[0]=='@'){//FASTQ record: header, sequence, '+', qualities
+
+			string seq, plus, qual;
+
+			std::getline(in,seq);
+			std::getline(in,plus);
+			std::getline(in,qual);
+			line_nr+=3;
+
+			if(seq.length()>0 and seq[seq.length()-1]=='\r')
+				seq.erase(seq.length()-1);
+
+			patterns.push_back(pair<string,string>(line.substr(1),seq));
+
+		}else{
+
+			patterns.push_back(pair<string,string>(std::to_string(line_nr),line));
+
+		}
+
+	}
+
+	return patterns;
+
+}
+
+/*
+ * search all patterns of patterns_path in the dB-hash with 'threads' threads. One line per pattern is written in output_path:
+ * name <TAB> number of occurrences <TAB> comma-separated occurrences ('-' if none). Patterns of wrong length: name <TAB> *
+ */
+void batchSearch(DBhash &dBhash, string patterns_path, string output_path, uint threads, uint max_errors){
+
+	using std::chrono::high_resolution_clock;
+	using std::chrono::duration;
+
+	cout << "Reading patterns from " << patterns_path << endl;
+	vector<pair<string,string> > patterns = readPatterns(patterns_path);
+	cout << "Done. " << patterns.size() << " patterns read." << endl;
+
+	cout << "\nSearching with " << threads << " threads (max " << max_errors << " mismatches) ..." << endl;
+
+	vector<string> results(patterns.size());
+	vector<DBhash::query_stats> stats(threads);
+
+	std::atomic<ulint> next_pattern(0);
+	const ulint chunk = 256;//patterns assigned to a thread at once
+
+	auto t1 = high_resolution_clock::now();
+
+	auto worker = [&](uint t){
+
+		ulint b;
+		while((b = next_pattern.fetch_add(chunk)) < patterns.size()){
+
+			for(ulint i=b;i<std::min(b+chunk,(ulint)patterns.size());i++){
+
+				string &P = patterns[i].second;
+				string &res = results[i];
+
+				res = patterns[i].first;
+
+				if(P.length()<dBhash.patternLength()){//patterns longer than m are searched by seeds
+
+					res.append("\t*");
+					continue;
+
+				}
+
+				vector<ulint> occ = dBhash.getOccurrencies(P, max_errors, stats[t]);
+
+				std::sort(occ.begin(),occ.end());
+
+				res.append("\t").append(std::to_string(occ.size())).append("\t");
+
+				if(occ.size()==0)
+					res.append("-");
+
+				for(ulint j=0;j<occ.size();j++){
+
+					if(j>0) res.append(",");
+					res.append(std::to_string(occ[j]));
+
+				}
+
+			}
+
+		}
+
+	};
+
+	vector<std::thread> pool;
+	for(uint t=0;t<threads;t++)
+		pool.push_back(std::thread(worker,t));
+
+	for(auto &th : pool)
+		th.join();
+
+	auto t2 = high_resolution_clock::now();
+	double search_time = duration<double>(t2-t1).count();
+
+	FILE *fp;
+
+	if ((fp = fopen(output_path.c_str(), "w")) == NULL) {
+		VERBOSE_CHANNEL<< "Cannot open file "  << output_path <<endl;
+		exit(1);
+	}
+
+	for(auto &r : results){
+
+		fwrite(r.data(), sizeof(char), r.length(), fp);
+		fputc('\n',fp);
+
+	}
+
+	fclose(fp);
+
+	DBhash::query_stats total;
+	for(uint t=0;t<threads;t++)
+		total.add(stats[t]);
+
+	cout << "Done. Results stored in " << output_path << endl << endl;
+
+	cout << "Searched patterns: " << total.queries << " (" << patterns.size()-total.queries << " skipped: wrong length)" << endl;
+	cout << "Searched fingerprints: " << total.fingerprints << " (Hamming neighbourhood of the pattern fingerprints)" << endl;
+	cout << "Candidate occurrences: " << total.candidates << ", verified occurrences: " << total.occurrences << endl;
+	cout << "Wall-clock search time: " << search_time << "s (" << (search_time>0 ? total.queries/search_time : 0) << " patterns/s)" << endl << endl;
+
+	cout << "Time per stage (summed over threads):" << endl;
+	cout << " hash           : " << total.hash << "s" << endl;
+	cout << " aux-hash lookup: " << total.aux_lookup << "s" << endl;
+	cout << " backward search: " << total.backward_search << "s" << endl;
+	cout << " locate         : " << total.locate << "s" << endl;
+	cout << " verification   : " << total.verification << "s" << endl << endl;
+
+	OccurrenceCache * cache = dBhash.occurrenceCache();
+
+	if(cache!=NULL){
+
+		cout << "Cache: " << cache->size() << " fingerprints, hit rate " << cache->hitRate()*100 << "% (";
+		cout << cache->hitCount() << " occurrence hits, " << cache->intervalHitCount() << " interval hits, ";
+		cout << cache->missCount() << " misses, " << cache->evictionCount() << " evictions)" << endl << endl;
+
+	}
+
+}
+
+/*
+ * prints the parameters of the dB-hash and its hash load: the number of fingerprints having i occurrences in the text,
+ * for i=0,...,max_load-1 (the last row counts the fingerprints with at least max_load occurrences)
+ */
+void printStats(DBhash &dBhash, ulint max_load){
+
+	HashFunction h = dBhash.hashFunction();
+
+	cout << "Text length n = " << dBhash.textLength() << endl;
+	cout << "Pattern length m = " << dBhash.patternLength() << endl;
+	cout << "Fingerprint length w = " << h.w << " digits in base " << (1<<h.log_base) << endl;
+	cout << "Auxiliary hash: " << dBhash.auxiliaryHashDigits() << " digits" << endl;
+	cout << "Size of the structure = " << (double)dBhash.size()/(dBhash.textLength()*8) << "n Bytes" << endl << endl;
+
+	cout << "Computing the hash load ... " << flush;
+	vector<ulint> load = dBhash.hashLoad(max_load);
+	cout << "Done." << endl << endl;
+
+	ulint occurring = 0;//fingerprints with at least one occurrence
+	ulint positions = 0;//text positions (counted up to max_load per fingerprint)
+	ulint largest = 0;
+
+	for(ulint i=1;i<load.size();i++){
+
+		occurring += load[i];
+		positions += i*load[i];
+
+		if(load[i]>0)
+			largest = i;
+
+	}
+
+	cout << "Fingerprints occurring in the text: " << occurring << endl;
+	cout << "Average load of the non-empty lists: " << (occurring>0 ? (double)positions/occurring : 0) << endl;
+	cout << "Largest load: " << (largest==max_load ? ">= " : "") << largest << endl << endl;
+
+	cout << "occurrences\tfingerprints" << endl;
+
+	for(ulint i=0;i<load.size();i++)
+		if(load[i]>0)
+			cout << (i==max_load ? ">=" : "") << i << "\t" << load[i] << endl;
+
 }
 
  int main(int argc,char** argv) {
 
-	if(argc != 4){
+	bool stats_mode = argc>=3 and string(argv[1]).compare("stats")==0;
+
+	if((argc < 4 and not stats_mode) or (string(argv[1]).compare("batch")!=0 and not stats_mode and argc != 4)){
 		cout << "*** dB-hash data structure ***\n";
 		cout << "Usage: dB-hash option file [pattern] [pattern_length]\n";
+		cout << "       dB-hash batch file patterns_file output_file [threads] [max_errors] [cache_MB]\n";
+		cout << "       dB-hash stats file [max_load]\n";
 		cout << "where: \n";
 		cout <<	"- option = build|search.\n";
-		cout <<	"- file = path of the text file (if build mode) or dB-hash .dbh file (if search mode). \n";
+		cout <<	"- file = path of the text file (if build mode) or dB-hash .dbh file (if search/batch/stats mode). In build mode, files with\n";
+		cout <<	"  extension .fa/.fasta/.fna/.fq/.fastq/.2bit (optionally .gz) are read as sequence files: only their sequences are indexed.\n";
 		cout << "- pattern_length = In build mode, specify this parameter, which is the pattern length\n";
 		cout << "- pattern = must be specified in search mode. It is the pattern to be searched in the index.\n";
+		cout << "- patterns_file = (batch mode) FASTA, FASTQ or plain (one pattern per line) file of patterns.\n";
+		cout << "- output_file = (batch mode) one line per pattern: name, number of occurrences, comma-separated occurrences.\n";
+		cout << "- threads = (batch mode, optional) number of threads. Default: 1\n";
+		cout << "- max_errors = (batch mode, optional) maximum Hamming distance of the occurrences. The fingerprints h(P) XOR z, for\n";
+		cout << "  all z in the sets Z(1),...,Z(max_errors) of the hash function, are searched and the candidates are verified.\n";
+		cout << "  The Z set is built up to radius 2: with max_errors>2, only the occurrences whose fingerprint is within\n";
+		cout << "  radius 2 from h(P) are found. Default: 0\n";
+		cout << "- cache_MB = (batch mode, optional) size of the cache of fingerprint lookups, shared by the threads. Useful when\n";
+		cout << "  many patterns are identical or similar. Default: 0 (no cache)\n";
+		cout << "- max_load = (stats mode, optional) the hash load (number of fingerprints having i occurrences) is printed\n";
+		cout << "  for i < max_load. Default: 10000\n";
 		exit(0);
 	}
 
@@ -88,7 +332,7 @@ DBhash buildFromFile(string text_path, uint m){
     using std::chrono::duration_cast;
     using std::chrono::duration;
 
-	int build=0,search=1;
+	int build=0,search=1,batch=2,stats=3;
 
 	int mode;
 
@@ -96,6 +340,10 @@ DBhash buildFromFile(string text_path, uint m){
 		mode=build;
 	else if(string(argv[1]).compare("search")==0)
 		mode=search;
+	else if(string(argv[1]).compare("batch")==0)
+		mode=batch;
+	else if(string(argv[1]).compare("stats")==0)
+		mode=stats;
 	else{
 		cout << "Unrecognized option "<<argv[1]<<endl;
 		exit(0);
@@ -140,8 +388,8 @@ DBhash buildFromFile(string text_path, uint m){
 		dBhash = DBhash::loadFromFile(in);
 		cout << "Done." << endl;
 
-		if(dBhash.patternLength()!=m){
-			cout << "Error: structure built with pattern length " << dBhash.patternLength() << ", but now searching a pattern of length " << m << endl;
+		if(m<dBhash.patternLength()){
+			cout << "Error: structure built with pattern length " << dBhash.patternLength() << ", but now searching a shorter pattern of length " << m << endl;
 			exit(1);
 		}
 
@@ -158,6 +406,55 @@ DBhash buildFromFile(string text_path, uint m){
 
 	}
 
+	if(mode==batch){
+
+		if(argc < 5 or argc > 8){
+			cout << "Usage: dB-hash batch file patterns_file output_file [threads] [max_errors] [cache_MB]\n";
+			exit(0);
+		}
+
+		uint threads = (argc>=6 ? atoi(argv[5]) : 1);
+		uint max_errors = (argc>=7 ? atoi(argv[6]) : 0);
+		ulint cache_MB = (argc>=8 ? atol(argv[7]) : 0);
+
+		if(threads==0){
+			cout << "Error: number of threads must be at least 1\n";
+			exit(1);
+		}
+
+		cout << "Loading dB-hash from file "<< in <<endl;
+		dBhash = DBhash::loadFromFile(in);
+		cout << "Done." << endl << endl;
+
+		if(cache_MB>0)
+			dBhash.enableCache(cache_MB*(((ulint)1)<<20));
+
+		batchSearch(dBhash, string(argv[3]), string(argv[4]), threads, max_errors);
+
+	}
+
+	if(mode==stats){
+
+		if(argc > 4){
+			cout << "Usage: dB-hash stats file [max_load]\n";
+			exit(0);
+		}
+
+		ulint max_load = (argc>=4 ? atol(argv[3]) : 10000);
+
+		if(max_load==0){
+			cout << "Error: max_load must be at least 1\n";
+			exit(1);
+		}
+
+		cout << "Loading dB-hash from file "<< in <<endl;
+		dBhash = DBhash::loadFromFile(in);
+		cout << "Done." << endl << endl;
+
+		printStats(dBhash, max_load);
+
+	}
+
 	printRSSstat();
 	auto t2 = high_resolution_clock::now();
 	ulint total = duration_cast<duration<double, std::ratio<1>>>(t2 - t1).count();
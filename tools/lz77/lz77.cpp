@@ -16,9 +16,14 @@
 
 #include "../../data_structures/LZ77.h"
 #include "../../data_structures/lz77_parser.h"
+#include "../../data_structures/lz77_sinks.h"
 #include <sstream>
 #include <iostream>
 #include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 
 using namespace bwtil;
 
@@ -27,6 +32,13 @@ bool save_parse=false;
 string out_filename;
 char sep_out;
 
+//segment mode: segments are parsed independently (references only inside the segment)
+uint threads=0;
+ulint segment_block=0;
+
+//sliding window size (0 = whole text)
+ulint window=0;
+
 void help(){
 	cout << "*** Count number of phrases in the LZ77 parse of the file ***\n";
 	cout << "*** Input file must not contain a 0x0 character, since 0x0 is automatically appended as terminator. ***\n";
@@ -36,6 +48,11 @@ void help(){
 	cout << "--v2 : LZ77 variant 2: when extending the current phrase W with a character c, if Wc does not occur previously, a new phrase W is inserted in the dictionary, and c is part of the next phrase. If W=empty, a new phrase 'c' is inserted in the dictionary, and the next phrase is initialized empty."<<endl;
 	cout << "--p arg : output the number of phrases every <arg> characters."<<endl;
 	cout << "--s arg : output the number of phrases each time a character equal to <arg> is encountered. Warning: <arg> characters are skipped and not taken into account in the LZ parse."<<endl;
+	cout << "--t : print the parse to standard output, one token per line: (start_position,length) or 'c' for the first occurrence of a character c. Variant 2 only, not compatible with --p and --s."<<endl;
+	cout << "--o arg : save the parse to the binary file <arg>: two 64-bit integers per token, <start_position,length> or <c,0> for the first occurrence of a character c. Variant 2 only, not compatible with --p and --s."<<endl;
+	cout << "--b arg : segment mode: split the text in blocks of <arg> characters and parse them independently (phrases reference only their own block). Variant 2 only, not compatible with --s."<<endl;
+	cout << "--threads arg : segment mode: parse the segments with <arg> threads. Segments are the blocks of --b or, if --b is not given, the documents delimited by the separator of --s. The number of phrases of each segment is printed."<<endl;
+	cout << "--w arg : sliding-window parse: phrases are at most <arg> characters long and reference only the previous <arg> characters. The memory used does not grow with the text. Variant 2 only, not compatible with --p, --s and segment mode."<<endl;
 	cout << "--verbose : [default:false] show percentage of work done."<<endl;
 	exit(0);
 }
@@ -72,6 +89,76 @@ lz77_t::options parse(lz77_t::options &opt, int &ptr, char** argv, int argc){
 
 		ptr++;
 
+	}else if(s.compare("--t")==0){
+
+		print_parse = true;
+
+	}else if(s.compare("--o")==0){
+
+		if(ptr>=argc){
+			cout<<"Missing file name in option --o" << endl;
+			help();
+		}
+
+		save_parse = true;
+		out_filename = string(argv[ptr]);
+
+		ptr++;
+
+	}else if(s.compare("--b")==0){
+
+		if(ptr>=argc){
+			cout<<"Missing block size in option --b" << endl;
+			help();
+		}
+
+		long block_size = atol(argv[ptr]);
+
+		if(block_size<=0){
+			cout << "error: block size in --b must be > 0" << endl;
+			help();
+		}
+
+		segment_block=block_size;
+
+		ptr++;
+
+	}else if(s.compare("--threads")==0){
+
+		if(ptr>=argc){
+			cout<<"Missing number of threads in option --threads" << endl;
+			help();
+		}
+
+		int t = atoi(argv[ptr]);
+
+		if(t<=0){
+			cout << "error: number of threads in --threads must be > 0" << endl;
+			help();
+		}
+
+		threads=t;
+
+		ptr++;
+
+	}else if(s.compare("--w")==0){
+
+		if(ptr>=argc){
+			cout<<"Missing window size in option --w" << endl;
+			help();
+		}
+
+		long w = atol(argv[ptr]);
+
+		if(w<=0){
+			cout << "error: window size in --w must be > 0" << endl;
+			help();
+		}
+
+		window=w;
+
+		ptr++;
+
 	}else if(s.compare("--verbose")==0){
 
 		opt.verbose = true;
@@ -102,6 +189,260 @@ lz77_t::options parse(lz77_t::options &opt, int &ptr, char** argv, int argc){
 	return opt;
 }
 
+//a segment of the input file, parsed independently
+struct segment{
+
+	ulint file_offset;
+	ulint length;
+	ulint text_offset;//position of the segment in the parsed text (the file without separators)
+
+};
+
+//output of the tool: the tokens are printed (--t) and/or saved to the binary file (--o)
+struct output_sink{
+
+	output_sink(std::ostream &out_file) : text_sink(cout), binary_sink(out_file){}
+
+	void write(lz77_token &t){
+
+		if(print_parse)
+			text_sink.write(t);
+
+		if(save_parse)
+			binary_sink.write(t);
+
+	}
+
+	lz77_text_sink text_sink;
+	lz77_binary_sink binary_sink;
+
+};
+
+//stores the tokens of a segment
+struct token_buffer{
+
+	vector<lz77_token> tokens;
+
+	void write(lz77_token &t){tokens.push_back(t);}
+
+};
+
+//blocks of block_size characters (block_size>0) or maximal runs of non-separator characters
+vector<segment> find_segments(string path, ulint block_size, symbol sep){
+
+	vector<segment> segments;
+
+	ifstream ifs(path, ios::binary);
+
+	if(block_size>0){
+
+		ifs.seekg(0, ios::end);
+		ulint n = ifs.tellg();
+
+		for(ulint b=0;b<n;b+=block_size)
+			segments.push_back({b, std::min(block_size,n-b), b});
+
+		return segments;
+
+	}
+
+	const ulint buffer_size = 1<<20;
+	vector<char> buffer(buffer_size);
+
+	ulint pos=0;
+	ulint text_pos=0;
+	bool in_segment=false;
+
+	while(ifs){
+
+		ifs.read(buffer.data(), buffer_size);
+		ulint len = ifs.gcount();
+
+		for(ulint i=0;i<len;i++,pos++){
+
+			if((symbol)buffer[i]==sep){
+
+				in_segment=false;
+
+			}else{
+
+				if(not in_segment)
+					segments.push_back({pos, 0, text_pos});
+
+				in_segment=true;
+				segments.back().length++;
+				text_pos++;
+
+			}
+
+		}
+
+	}
+
+	return segments;
+
+}
+
+//alphabet and frequencies of the segment, read from ifs in blocks (the segment is never copied in memory)
+set<pair<uchar,ulint> > segment_alphabet_and_frequencies(ifstream &ifs, segment &seg){
+
+	const ulint buffer_size = 1<<16;
+	vector<char> buffer(buffer_size);
+
+	vector<ulint> freqs(256,0);
+
+	ifs.clear();
+	ifs.seekg(seg.file_offset);
+
+	for(ulint done=0;done<seg.length;){
+
+		ulint len = std::min(buffer_size,seg.length-done);
+		ifs.read(buffer.data(), len);
+
+		for(ulint i=0;i<len;i++)
+			freqs[(uchar)buffer[i]]++;
+
+		done += len;
+
+	}
+
+	set<pair<uchar,ulint> > aaf;
+
+	for(uint c=0;c<256;c++)
+		if(freqs[c]>0)
+			aaf.insert({(uchar)c,freqs[c]});
+
+	return aaf;
+
+}
+
+/*
+ * parses the segments with 'threads' threads, each with its own dynamic BWT. The tokens are merged in text order (start
+ * positions are shifted to text coordinates) and passed to the sinks; the number of phrases of each segment is printed.
+ */
+ulint parse_segments(string path, vector<segment> &segments, uint threads, bool verbose){
+
+	vector<token_buffer> results(segments.size());
+	vector<bool> done(segments.size(),false);
+
+	std::mutex m;
+	std::condition_variable cv;
+	std::atomic<ulint> next_segment(0);
+
+	auto worker = [&](){
+
+		ifstream ifs(path, ios::binary);
+
+		ulint i;
+		while((i = next_segment++) < segments.size()){
+
+			set<pair<uchar,ulint> > aaf = segment_alphabet_and_frequencies(ifs, segments[i]);
+
+			//the parser reads exactly segments[i].length characters from the current position of ifs
+			ifs.clear();
+			ifs.seekg(segments[i].file_offset);
+
+			lz77_parser<> parser(ifs, aaf, 8, false);
+
+			token_buffer tb;
+			parser.parse(tb);
+
+			std::lock_guard<std::mutex> lock(m);
+			results[i] = std::move(tb);
+			done[i] = true;
+			cv.notify_all();
+
+		}
+
+	};
+
+	vector<std::thread> pool;
+	for(uint t=0;t<threads;t++)
+		pool.push_back(std::thread(worker));
+
+	ofstream out_file;
+	if(save_parse)
+		out_file.open(out_filename, ios::binary);
+
+	output_sink out(out_file);
+
+	if(not print_parse)
+		cout << "segment\tstart\tlength\tphrases" << endl;
+
+	ulint number_of_phrases=0;
+
+	//merge the token streams in segment order, as soon as they are available
+	for(ulint i=0;i<segments.size();i++){
+
+		token_buffer tb;
+
+		{
+			std::unique_lock<std::mutex> lock(m);
+			cv.wait(lock, [&]{return done[i];});
+			tb = std::move(results[i]);
+		}
+
+		for(auto &t : tb.tokens){
+
+			if(t.start_position_is_defined)
+				t.start_position += segments[i].text_offset;
+
+			out.write(t);
+
+		}
+
+		if(not print_parse)
+			cout << i << "\t" << segments[i].text_offset << "\t" << segments[i].length << "\t" << tb.tokens.size() << endl;
+
+		if(verbose)
+			cout << (i+1) << "/" << segments.size() << " segments done ..." << endl;
+
+		number_of_phrases += tb.tokens.size();
+
+	}
+
+	for(auto &t : pool)
+		t.join();
+
+	if(save_parse)
+		out_file.close();
+
+	return number_of_phrases;
+
+}
+
+/*
+ * parses the file with a parser of type parser_type, streaming the parse to the sinks: phrases are never stored as text.
+ * Returns the number of phrases.
+ */
+template<class parser_type>
+ulint stream_parse(string path, bool verbose){
+
+	set<pair<uchar,ulint> > aaf;
+
+	{
+		ifstream ifs(path, ios::binary);
+		aaf = parser_type::get_alphabet_and_frequencies(ifs);
+	}
+
+	ifstream ifs(path, ios::binary);
+	parser_type parser(ifs, aaf, 8, verbose, window);
+
+	ofstream out_file;
+	if(save_parse)
+		out_file.open(out_filename, ios::binary);
+
+	output_sink out(out_file);
+
+	ulint number_of_phrases = parser.parse(out);
+
+	if(save_parse)
+		out_file.close();
+
+	return number_of_phrases;
+
+}
+
  int main(int argc,char** argv) {
 
 /*	{
@@ -120,7 +461,7 @@ lz77_t::options parse(lz77_t::options &opt, int &ptr, char** argv, int argc){
 		while(not parser.eof()){
 
 			auto t = parser.get_token();
-			//cout << "<" << t.phrase << ", " << t.start_position << ", " << t.start_position_is_defined << "> ";
+			//cout << "<" << t.start_position << ", " << t.length << ", " << t.start_position_is_defined << "> ";
 
 		}
 
@@ -156,6 +497,51 @@ lz77_t::options parse(lz77_t::options &opt, int &ptr, char** argv, int argc){
 	opt.mode = file_path;//input string is a file path rather than a text to parse
 	opt.prepend_alphabet = false;//don't add the alphabet as prefix
 
+	if(threads>0 or segment_block>0){
+
+		if(opt.lz_variant!=lz77_t::v2 or opt.block>0 or window>0){
+			cout << "Error: segment mode (--b, --threads) requires --v2 and is not compatible with --p and --w." << endl;
+			help();
+		}
+
+		if((segment_block==0) == (opt.sep==0)){
+			cout << "Error: segment mode requires either the block size (--b) or the document separator (--s)." << endl;
+			help();
+		}
+
+		if(threads==0)
+			threads=1;
+
+		vector<segment> segments = find_segments(string(argv[ptr]), segment_block, opt.sep);
+
+		if(opt.verbose) cout << "Parsing " << segments.size() << " segments with " << threads << " threads ..." << endl;
+
+		ulint number_of_phrases = parse_segments(string(argv[ptr]), segments, threads, opt.verbose);
+
+		cout << "number of phrases: " << number_of_phrases << endl;
+
+		return 0;
+
+	}
+
+	if(print_parse or save_parse or window>0){
+
+		if(opt.lz_variant!=lz77_t::v2 or opt.block>0 or opt.sep>0){
+			cout << "Error: options --t, --o and --w require --v2 and are not compatible with --p and --s." << endl;
+			help();
+		}
+
+		//the windowed parse removes characters from the dynamic BWT: it needs a bitvector with remove
+		ulint number_of_phrases = window>0 ?
+				stream_parse<lz77_parser<packed_dynamic_bitvector_t> >(string(argv[ptr]), opt.verbose) :
+				stream_parse<lz77_parser<> >(string(argv[ptr]), opt.verbose);
+
+		cout << "number of phrases: " << number_of_phrases << endl;
+
+		return 0;
+
+	}
+
 	lz77_t lz77(opt,string(argv[ptr]));
 
 	ofstream out_file;
@@ -8,7 +8,7 @@
 // Heng Li - KSEQ LIB for parsing FASTA files
 #include <zlib.h>
 #include <stdio.h>
-#include "kseq.h"
+#include "../../extern/kseq.h"
 #include "kstring.h"
 KSEQ_INIT(gzFile, gzread)
 
@@ -278,13 +278,16 @@ string repeat(string s, int n)
 
 int main(int argc,char** argv) {
 
-	if(argc != 4 and argc != 3 and argc != 5){
+	if(argc < 3 or argc > 6){
 		cout << "*** succinct FM-index data structure : a wavelet-tree based uncompressed FM index ***\n";
-		cout << "Usage: sFM-index option file [pattern]\n";
+		cout << "Usage: sFM-index option file [pattern] [--count | --max k | --qgrams MB]\n";
 		cout << "where:\n";
 		cout <<	"- option = build|search|lz. \n";
-		cout << "- file = path of the text file (if build mode) or .sfm sFM-index file (if search mode). \n";
+		cout << "- file = path of the text file (if build mode) or .sfm sFM-index file (if search mode). Files with extension .fa/.fasta/.fna/.fq/.fastq/.2bit (optionally .gz) are read as sequence files: only their sequences are indexed.\n";
 		cout << "- pattern = must be specified in search mode. It is the pattern to be searched in the index.\n";
+		cout << "- --count = (search mode only) output only the number of occurrences, without locating them.\n";
+		cout << "- --max k = (search mode only) locate at most k occurrences.\n";
+		cout << "- --qgrams MB = (build mode only) store the BWT intervals of all q-grams using at most MB megabytes (q chosen automatically). Speeds up backward search.\n";
 		exit(0);
 	}
 
@@ -312,9 +315,62 @@ int main(int argc,char** argv) {
 	out.append(".sfm");
 
 	string pattern;
+	ulint qgram_budget = 0;//bytes. 0 = no q-gram table
+	bool count_only = false;
+	ulint max_occ = 0;//0 = locate all occurrences
+
+	if(mode==build and argc>3){
+
+		if(argc==5 and string(argv[3]).compare("--qgrams")==0 and atol(argv[4])>0){
+
+			qgram_budget = atol(argv[4])*(ulint(1)<<20);
+
+		}else{
+
+			cout << "Unrecognized option "<<argv[3]<<endl;
+			exit(0);
+
+		}
+
+	}
 
 	if(mode==search){
+
+		if(argc<4){
+			cout << "Error: missing pattern in search mode." << endl;
+			exit(0);
+		}
+
 		pattern = string(argv[3]);
+
+		if(argc==5 and string(argv[4]).compare("--count")==0){
+
+			count_only = true;
+
+		}else if(argc==6 and string(argv[4]).compare("--max")==0){
+
+			if(atol(argv[5])<=0){
+				cout << "Error: k in --max must be > 0." << endl;
+				exit(0);
+			}
+
+			max_occ = atol(argv[5]);
+
+		}else if(argc>4){
+
+			//first argument that is not part of a valid option
+			int bad = 4;
+
+			if(string(argv[4]).compare("--count")==0)
+				bad = 5;
+			else if(string(argv[4]).compare("--max")==0 and argc>6)
+				bad = 6;
+
+			cout << "Unrecognized option "<<argv[bad]<<endl;
+			exit(0);
+
+		}
+
 	}
 
   int k_seed;
@@ -336,7 +392,8 @@ int main(int argc,char** argv) {
 	if(mode==build){
 
 		cout << "Building succinct FM-index of file "<< in << endl;
-		SFMI = succinctFMIndex(in,true);
+		//FASTA/FASTQ/2-bit files (recognized by extension) are indexed directly: only their sequences are indexed
+		SFMI = succinctFMIndex(in,true,qgram_budget,SequenceFile::isSequenceFile(in) ? sequence_file_path : file_path);
 
 		cout << "\nStoring succinct FM-index in "<< out << endl;
 		SFMI.saveToFile(out);
@@ -353,14 +410,31 @@ int main(int argc,char** argv) {
 
 		cout << "\nSearching pattern \""<< pattern << "\""<<endl;
 
-		vector<ulint> occ = SFMI.getOccurrencies( pattern );
+		if(count_only){
 
-		cout << "The pattern occurs " << occ.size() << " times in the text at the following positions : \n";
+			cout << "The pattern occurs " << SFMI.count( pattern ) << " times in the text.\n";
 
-		for(uint i=0;i<occ.size();i++)
-			cout << occ.at(i) << " ";
+		}else{
+
+			auto it = SFMI.getOccurrenceIterator( pattern );
+
+			cout << "The pattern occurs " << it.numberOfOccurrences() << " times in the text";
+
+			if(max_occ>0 and it.numberOfOccurrences()>max_occ)
+				cout << ". First " << max_occ << " positions";
+			else
+				cout << " at the following positions";
+
+			cout << " : \n";
+
+			for(ulint i=0;it.hasNext() and (max_occ==0 or i<max_occ);i++)
+				cout << it.next() << " ";
+
+			cout << "\n";
+
+		}
 
-		cout << "\n\nDone.\n";
+		cout << "\nDone.\n";
 
 	}
 
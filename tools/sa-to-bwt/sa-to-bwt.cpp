@@ -22,24 +22,58 @@
  */
 
 #include "../../data_structures/FileReader.h"
+#include "../../data_structures/SuffixArrayFile.h"
+#include <thread>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 using namespace bwtil;
 
+//number of SA entries read, converted and written at once
+static const ulint block_size = 1<<20;
+
+/*
+ * fill bwt_block[k] = text[sa_block[k]-1] (0x0 if sa_block[k]=0), k in [begin,end).
+ * returns false if some address is out of range.
+ */
+bool gatherBWT(const uchar *text, ulint n, vector<ulint> &sa_block, vector<uchar> &bwt_block, ulint begin, ulint end){
+
+	bool ok = true;
+
+	for(ulint k=begin;k<end;k++){
+
+		ulint addr = sa_block[k];
+
+		ok = ok and addr<n;
+
+		bwt_block[k] = (addr==0 or addr>=n) ? 0 : text[addr-1];
+
+	}
+
+	return ok;
+
+}
+
  int main(int argc,char** argv) {
 
 #ifdef DEBUG
 	 cout << "\n ****** DEBUG MODE ******\n\n";
 #endif
 
-	if(argc != 3 and argc != 4){
+	if(argc < 3){
 		cout << "*** Suffix Array to BWT converter ***\n";
 		cout << "Given a suffix array file and a text file, builds the BWT and stores it directly to disk.\n";
 		cout << "The output BWT file will contain a 0x0 byte as text terminator.\n";
-		cout << "Usage: sa-to-bwt sa_file text_file [output_bwt_file]\n";
+		cout << "Usage: sa-to-bwt sa_file text_file [output_bwt_file] [-t threads] [-m]\n";
 		cout << "where:\n";
-		cout << "- sa_file is the input suffix array file. This file must contain n pointers to the text, each of size 8 bytes.\n";
+		cout << "- sa_file is the input suffix array file: n pointers to the text, each of size 8 bytes, or a packed/byte-aligned\n";
+		cout << "  SA file produced by bwt-to-sa -p/-b (the format is detected automatically).\n";
 		cout << "- text_file is the input text file. Input file must not contain a 0x0 byte since the algorithm uses it as text terminator.\n";
 		cout << "- output_bwt_file (optional) is the output bwt file. Default: text_file.bwt\n";
+		cout << "- threads (optional, default 1) is the number of threads converting each block of SA entries\n";
+		cout << "- -m (optional) memory-map the text file instead of loading it in RAM: only the pages accessed are resident\n";
 		exit(0);
 	}
 
@@ -50,29 +84,95 @@ using namespace bwtil;
     auto t1 = high_resolution_clock::now();
 
 	string bwt_path = string(argv[2]).append(".bwt");
+	uint threads = 1;
+	bool use_mmap = false;
+
+	for(int a=3;a<argc;a++){
+
+		if(string(argv[a]).compare("-t")==0 and a+1<argc){
+
+			threads = atoi(argv[++a]);
+
+			if(threads==0){
+				cout << "Error: number of threads must be at least 1\n";
+				exit(1);
+			}
+
+		}else if(string(argv[a]).compare("-m")==0){
+
+			use_mmap = true;
 
-	if(argc==4){
+		}else if(a==3){
 
-		bwt_path = string(argv[3]);
+			bwt_path = string(argv[3]);
+
+		}else{
+
+			cout << "Error: unrecognized option " << argv[a] << endl;
+			exit(1);
+
+		}
 
 	}
 
-	cout << "\nReading the text ... " << endl;
+	ulint n;
+	string text;
+	const uchar * text_ptr;
+	int text_fd = -1;
+
+	if(use_mmap){
+
+		cout << "\nMapping the text in memory ... " << endl;
+
+		struct stat st;
+
+		if ((text_fd = open(argv[2], O_RDONLY)) < 0 or fstat(text_fd, &st) != 0) {
+			VERBOSE_CHANNEL<< "Cannot open file "  << argv[2] <<endl;
+			exit(1);
+		}
+
+		n = st.st_size;
+
+		if(n==0){
+			cout << "Error: empty text file\n";
+			exit(1);
+		}
+
+		void * addr = mmap(NULL, n, PROT_READ, MAP_PRIVATE, text_fd, 0);
+
+		if(addr == MAP_FAILED){
+			cout << "Error: cannot map file " << argv[2] << " in memory\n";
+			exit(1);
+		}
+
+		text_ptr = (const uchar *)addr;
+
+	}else{
 
-	FileReader text_fr(argv[2]);
-	ulint n = text_fr.size();
-	string text = text_fr.toString();
-	text_fr.close();
+		cout << "\nReading the text ... " << endl;
+
+		FileReader text_fr(argv[2]);
+		n = text_fr.size();
+		text = text_fr.toString();
+		text_fr.close();
+
+		text_ptr = (const uchar *)text.data();
+
+	}
 
 	cout << "Done. Reading suffix array and building BWT ... " << endl;
 
-	FILE *fp_sa;
-	FILE *fp_bwt;
+	SuffixArrayFileReader sa_reader(argv[1]);
 
-	if ((fp_sa = fopen(argv[1], "rb")) == NULL) {
-		VERBOSE_CHANNEL<< "Cannot open file "  << argv[1] <<endl;
+	if(sa_reader.length() < n){
+
+		cout << "Error: premature end of the SA file\n";
 		exit(1);
+
 	}
+
+	FILE *fp_bwt;
+
 	if ((fp_bwt = fopen(bwt_path.c_str(), "wb")) == NULL) {
 		VERBOSE_CHANNEL<< "Cannot open file "  << bwt_path <<endl;
 		exit(1);
@@ -80,7 +180,7 @@ using namespace bwtil;
 
 	int bytes;
 
-	uchar symbol = text[n-1];
+	uchar symbol = text_ptr[n-1];
 
 	bytes = fwrite(&symbol, sizeof(uchar), 1, fp_bwt);
 
@@ -91,50 +191,90 @@ using namespace bwtil;
 
 	}
 
-	ulint addr;
-	for(ulint i=0;i<n;i++){
+	vector<ulint> sa_block(block_size);
+	vector<uchar> bwt_block(block_size);
 
-		bytes = fread(&addr, sizeof(ulint), 1, fp_sa);
+	int perc,last_perc=-1;
 
-		if(addr>=n){
+	for(ulint i=0;i<n;){
 
-			cout << "Error: read address greater than text length : " << addr << ">=" << n << " in position " << i << endl;
-			exit(1);
-
-		}
+		ulint len = std::min(block_size, n-i);
 
-		if(bytes<=0){
+		if(sa_reader.read(sa_block.data(), len) != len){
 
 			cout << "Error: premature end of the SA file\n";
 			exit(1);
 
 		}
 
-		if(addr==0){
+		bool ok = true;
+
+		if(threads==1 or len < threads){
 
-			symbol = 0;//terminator
+			ok = gatherBWT(text_ptr, n, sa_block, bwt_block, 0, len);
 
 		}else{
 
-			symbol = text[addr-1];
+			vector<char> ok_t(threads,true);
+			vector<std::thread> pool;
+
+			for(uint t=0;t<threads;t++)
+				pool.push_back(std::thread([&,t](){
+					ok_t[t] = gatherBWT(text_ptr, n, sa_block, bwt_block, (len*t)/threads, (len*(t+1))/threads);
+				}));
+
+			for(auto &th : pool)
+				th.join();
+
+			for(uint t=0;t<threads;t++)
+				ok = ok and ok_t[t];
 
 		}
 
-		bytes = fwrite(&symbol, sizeof(uchar), 1, fp_bwt);
+		if(not ok){
+
+			//find the first wrong address to report it
+			for(ulint k=0;k<len;k++)
+				if(sa_block[k]>=n){
+
+					cout << "Error: read address greater than text length : " << sa_block[k] << ">=" << n << " in position " << i+k << endl;
+					exit(1);
 
-		if(bytes<=0){
+				}
+
+		}
+
+		if(fwrite(bwt_block.data(), sizeof(uchar), len, fp_bwt) != len){
 
 			cout << "Error while writing bwt file.\n";
 			exit(1);
 
 		}
 
+		i += len;
+
+		perc=(100*i)/n;
+
+		if(perc>last_perc and perc%10==0){
+
+			cout << perc << "% done"<<endl;
+			last_perc=perc;
+
+		}
+
+	}
+
+	if(use_mmap){
+
+		munmap((void *)text_ptr, n);
+		close(text_fd);
+
 	}
 
 	cout << "Done. BWT stored in " << bwt_path << endl;
 
 	fclose(fp_bwt);
-	fclose(fp_sa);
+	sa_reader.close();
 
 	printRSSstat();
 
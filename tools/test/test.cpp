@@ -25,13 +25,21 @@
 #include "../../extern/bitvector/include/bitvector.h"
 #include "../../data_structures/sparse_bitvector.h"
 #include "../../data_structures/dynamic_vector.h"
+#include "../../data_structures/packed_dynamic_vector.h"
+#include "../../data_structures/packed_dynamic_bitvector.h"
+#include "../../data_structures/lz77_parser.h"
 #include "../../data_structures/DynamicBWT.h"
 #include "../../data_structures/cgap_dictionary.h"
 #include "../../data_structures/bsd_cgap.h"
 #include "../../data_structures/fid_cgap.h"
+#include "../../data_structures/BidirectionalFMIndex.h"
+#include "../../data_structures/SequenceFileReader.h"
+#include "../../data_structures/BackwardSequenceIterator.h"
 
 #include "bitview.h"
 #include <vector>
+#include <deque>
+#include <functional>
 
 
 using namespace bwtil;
@@ -201,6 +209,794 @@ void test_dynamic_vector(){
 	 cout << endl;
 }
 
+//random insert/remove/set on a packed_dynamic_vector, checked against a std::vector
+void test_packed_dynamic_vector(){
+
+	srand(time(NULL));
+
+	for(uint width : {1,5,17,64}){
+
+		cout << "Checking packed_dynamic_vector (width " << width << ") ... " << flush;
+
+		//small leaves and degree: many splits, merges and redistributions
+		packed_dynamic_vector<256,4> pdv(100000,width);
+		vector<ulint> V;
+
+		ulint mask = width==64 ? ~ulint(0) : (ulint(1)<<width)-1;
+
+		for(ulint k=0;k<200000;k++){
+
+			//first the vector grows, then it shrinks
+			uint op = rand()%4;
+			bool grow = k<100000 ? op>0 : op==0;
+
+			ulint x = ((ulint(rand())<<40) ^ (ulint(rand())<<20) ^ ulint(rand())) & mask;
+
+			if(V.size()==0 or grow){
+
+				ulint i = rand()%(V.size()+1);
+
+				pdv.insert(i,x);
+				V.insert(V.begin()+i,x);
+
+			}else if(rand()%4>0){
+
+				ulint i = rand()%V.size();
+
+				if(pdv.remove(i)!=V[i]){
+					cout << "ERROR in remove(" << i << ")" << endl;
+					exit(1);
+				}
+
+				V.erase(V.begin()+i);
+
+			}else{
+
+				ulint i = rand()%V.size();
+
+				pdv.set(i,x);
+				V[i] = x;
+
+			}
+
+			if(pdv.size()!=V.size()){
+				cout << "ERROR in size: " << pdv.size() << " instead of " << V.size() << endl;
+				exit(1);
+			}
+
+			if(k%10000!=0)
+				continue;
+
+			ulint psum=0;
+
+			for(ulint i=0;i<V.size();i++){
+
+				if(pdv.psum(i)!=psum){
+					cout << "ERROR in psum(" << i << ")" << endl;
+					exit(1);
+				}
+
+				if(pdv.get(i)!=V[i]){
+					cout << "ERROR in get(" << i << ")" << endl;
+					exit(1);
+				}
+
+				psum += V[i];
+
+			}
+
+		}
+
+		cout << "ok. (height " << pdv.treeHeight() << ")" << endl;
+
+	}
+
+}
+
+typedef DynamicBWT<packed_dynamic_bitvector<256,4>, packed_dynamic_vector<128,4> > window_bwt_t;
+
+//compares the dynamic BWT of t (terminator = sigma) with the BWT of t built by sorting its suffixes
+bool check_bwt(window_bwt_t &bwt, std::deque<symbol> &t, symbol sigma){
+
+	ulint m = t.size();
+
+	vector<ulint> sa(m+1);
+	for(ulint i=0;i<=m;i++)
+		sa[i]=i;
+
+	//the terminator is smaller than all characters: compare the suffixes as sequences of ints, terminated by -1
+	auto suffix = [&](ulint i){
+
+		vector<int> v(t.begin()+i, t.end());
+		v.push_back(-1);
+
+		return v;
+
+	};
+
+	std::sort(sa.begin(), sa.end(), [&](ulint a, ulint b){return suffix(a) < suffix(b);});
+
+	if(bwt.size()!=m+1)
+		return false;
+
+	for(ulint r=0;r<=m;r++){
+
+		symbol c = sa[r]==0 ? sigma : t[sa[r]-1];
+
+		if(bwt.access(r)!=c or bwt.locate_right(r)!=m-sa[r] or bwt.locate(r)!=sa[r])
+			return false;
+
+	}
+
+	return true;
+
+}
+
+//random extend/remove_last on a dynamic BWT, checked against the BWT of the current text after each operation
+void test_remove_last(){
+
+	srand(time(NULL));
+
+	cout << "Checking DynamicBWT::remove_last ... " << flush;
+
+	for(uint trial=0;trial<200;trial++){
+
+		symbol sigma = 1+rand()%4;
+		ulint N = 200;//maximum text length
+
+		window_bwt_t bwt(vector<ulint>(sigma,N), 1+rand()%5);
+		std::deque<symbol> t;//the text: extend prepends a character, remove_last removes the last one
+
+		bool repetitive = rand()%2;//copy characters of the text: long repeats, many rows to move in remove_last
+
+		for(uint op=0;op<300;op++){
+
+			if(t.size()==0 or (rand()%3>0 and t.size()<N-1)){
+
+				symbol c = repetitive and t.size()>0 and rand()%4>0 ? t[rand()%t.size()] : rand()%sigma;
+
+				bwt.extend(c);
+				t.push_front(c);
+
+			}else{
+
+				bwt.remove_last();
+				t.pop_back();
+
+			}
+
+			if(not check_bwt(bwt,t,sigma)){
+
+				cout << "ERROR: wrong BWT after " << op+1 << " operations. Text: ";
+
+				for(auto c : t)
+					cout << (uint)c;
+
+				cout << endl;
+				exit(1);
+
+			}
+
+		}
+
+	}
+
+	cout << "ok." << endl;
+
+}
+
+//windowed LZ77 parse of random texts, decoded and compared with the text
+//repetitive text of length at least n on a small alphabet
+string random_repetitive_text(ulint n){
+
+	string text;
+
+	while(text.length()<n){
+
+		if(text.length()>0 and rand()%2){
+
+			ulint start = rand()%text.length();
+			ulint length = std::min((ulint)rand()%300, text.length()-start);
+
+			text += text.substr(start,length);
+
+		}else{
+
+			text += (char)('a'+rand()%4);
+
+		}
+
+	}
+
+	return text;
+
+}
+
+void test_windowed_lz77(){
+
+	srand(time(NULL));
+
+	cout << "Checking windowed LZ77 parse ... " << flush;
+
+	for(uint trial=0;trial<100;trial++){
+
+		ulint window = 1+rand()%100;
+		string text = random_repetitive_text(5000);
+
+		set<pair<uchar,ulint> > aaf;
+
+		{
+			std::istringstream is(text);
+			aaf = lz77_parser<packed_dynamic_bitvector_t>::get_alphabet_and_frequencies(is);
+		}
+
+		std::istringstream is(text);
+		lz77_parser<packed_dynamic_bitvector_t> parser(is, aaf, 1+rand()%8, false, window);
+
+		string decoded;
+
+		while(not parser.eof()){
+
+			auto t = parser.get_token();
+
+			if(not t.start_position_is_defined){
+
+				decoded += t.character;
+				continue;
+
+			}
+
+			//the source starts in the window and the phrase is not longer than the window
+			if(t.length>window or t.start_position+window<decoded.length() or t.start_position>=decoded.length()){
+
+				cout << "ERROR: token (" << t.start_position << "," << t.length << ") at position " << decoded.length()
+					 << " exceeds the window " << window << endl;
+				exit(1);
+
+			}
+
+			for(ulint j=0;j<t.length;j++)
+				decoded += decoded[t.start_position+j];
+
+		}
+
+		if(decoded!=text){
+
+			cout << "ERROR: the decoded parse differs from the text (window " << window << ")" << endl;
+			exit(1);
+
+		}
+
+	}
+
+	cout << "ok." << endl;
+
+}
+
+//a dynamic BWT saved after random extend/remove_last and loaded back must continue as the original one
+void test_dynamic_bwt_save_load(){
+
+	srand(time(NULL));
+
+	cout << "Checking DynamicBWT save/load ... " << flush;
+
+	string path = "test_dynamic_bwt.bin";
+
+	for(uint trial=0;trial<50;trial++){
+
+		symbol sigma = 1+rand()%4;
+		ulint N = 400;//maximum text length
+
+		window_bwt_t bwt(vector<ulint>(sigma,N), 1+rand()%5);
+		std::deque<symbol> t;
+
+		//extends the BWT or removes its last character, and updates the text t
+		auto random_operation = [&](window_bwt_t &b){
+
+			if(t.size()==0 or (rand()%3>0 and t.size()<N-1)){
+
+				symbol c = rand()%sigma;
+
+				b.extend(c);
+				t.push_front(c);
+
+			}else{
+
+				b.remove_last();
+				t.pop_back();
+
+			}
+
+		};
+
+		for(uint op=rand()%300;op>0;op--)
+			random_operation(bwt);
+
+		bwt.saveToFile(path);
+
+		window_bwt_t loaded;
+		loaded.load(path);
+
+		remove(path.c_str());
+
+		for(uint op=0;op<100;op++){
+
+			if(not check_bwt(loaded,t,sigma)){
+				cout << "ERROR: wrong BWT " << op << " operations after loading" << endl;
+				exit(1);
+			}
+
+			random_operation(loaded);
+
+		}
+
+	}
+
+	cout << "ok." << endl;
+
+}
+
+//a parse saved after k tokens and resumed must produce the same tokens as the uninterrupted parse
+void test_lz77_save_resume(){
+
+	srand(time(NULL));
+
+	cout << "Checking lz77_parser save/resume ... " << flush;
+
+	typedef lz77_parser<packed_dynamic_bitvector_t> parser_t;
+
+	string path = "test_lz77_parser.bin";
+
+	auto same = [](parser_t::token a, parser_t::token b){
+
+		return a.start_position_is_defined==b.start_position_is_defined and a.character==b.character and
+			(not a.start_position_is_defined or (a.start_position==b.start_position and a.length==b.length));
+
+	};
+
+	for(uint trial=0;trial<50;trial++){
+
+		ulint window = rand()%2 ? 0 : 1+rand()%100;//whole text or sliding window
+		ulint sample_rate = 1+rand()%8;
+
+		string text = random_repetitive_text(3000);
+
+		set<pair<uchar,ulint> > aaf;
+
+		{
+			std::istringstream is(text);
+			aaf = parser_t::get_alphabet_and_frequencies(is);
+		}
+
+		vector<parser_t::token> full;
+
+		{
+			std::istringstream is(text);
+			parser_t parser(is, aaf, sample_rate, false, window);
+
+			while(not parser.eof())
+				full.push_back(parser.get_token());
+		}
+
+		ulint k = rand()%(full.size()+1);//tokens before saving
+		vector<parser_t::token> resumed;
+
+		{
+			std::istringstream is(text);
+			parser_t parser(is, aaf, sample_rate, false, window);
+
+			while(resumed.size()<k)
+				resumed.push_back(parser.get_token());
+
+			parser.saveToFile(path);
+		}
+
+		{
+			std::istringstream is(text);
+			parser_t parser;
+			parser.load(is, path);
+
+			while(not parser.eof())
+				resumed.push_back(parser.get_token());
+		}
+
+		remove(path.c_str());
+
+		bool ok = resumed.size()==full.size();
+
+		for(ulint i=0;ok and i<full.size();i++)
+			ok = same(full[i],resumed[i]);
+
+		if(not ok){
+			cout << "ERROR: parse resumed after " << k << " tokens differs from the uninterrupted one (window " << window << ")" << endl;
+			exit(1);
+		}
+
+	}
+
+	cout << "ok." << endl;
+
+}
+
+//approximate search with search schemes, checked against a scan of the text with the Hamming distance
+void test_bidirectional_fm_index(){
+
+	srand(time(NULL));
+
+	cout << "Checking BidirectionalFMIndex::getApproximateOccurrencies ... " << flush;
+
+	string alphabet = "ACGT";
+
+	//repetitive text: many occurrences at small distance
+	string text;
+
+	while(text.length()<20000){
+
+		if(text.length()>100 and rand()%2){
+
+			string copy = text.substr(rand()%(text.length()-100), 1+rand()%100);
+
+			for(auto &c : copy)
+				if(rand()%20==0)
+					c = alphabet[rand()%4];
+
+			text += copy;
+
+		}else{
+
+			text += alphabet[rand()%4];
+
+		}
+
+	}
+
+	BidirectionalFMIndex bfmi(text);
+
+	for(uint trial=0;trial<500;trial++){
+
+		uint k = rand()%5;
+		ulint m = 1+rand()%30;
+
+		//mutated substring of the text
+		string P = text.substr(rand()%(text.length()-m), m);
+
+		for(uint e=rand()%(k+2);e>0;e--)
+			P[rand()%m] = alphabet[rand()%4];
+
+		vector<ulint> occ;
+
+		for(ulint i=0;i+m<=text.length();i++){
+
+			uint d=0;
+
+			for(ulint j=0;j<m and d<=k;j++)
+				d += P[j]!=text[i+j];
+
+			if(d<=k)
+				occ.push_back(i);
+
+		}
+
+		if(bfmi.getApproximateOccurrencies(P,k)!=occ){
+
+			cout << "ERROR: wrong occurrences of " << P << " with " << k << " mismatches" << endl;
+			exit(1);
+
+		}
+
+	}
+
+	cout << "ok." << endl;
+
+}
+
+//UCSC 2-bit file containing the sequences seqs (N runs and lowercase runs are taken from the sequences)
+string two_bit_file(vector<string> seqs, bool big_endian, uint version){
+
+	string out;
+
+	auto put32 = [&](uint32_t x){
+
+		for(uint b=0;b<4;b++)
+			out += (char)( big_endian ? x>>(24-8*b) : x>>(8*b) );
+
+	};
+
+	//runs of the positions of s satisfying f
+	auto runs = [](string &s, std::function<bool(char)> f){
+
+		vector<pair<uint32_t,uint32_t> > r;
+
+		for(uint32_t i=0;i<s.length();i++)
+			if(f(s[i])){
+
+				if(r.size()>0 and r.back().first+r.back().second==i)
+					r.back().second++;
+				else
+					r.push_back({i,1});
+
+			}
+
+		return r;
+
+	};
+
+	put32(0x1A412743);
+	put32(version);
+	put32(seqs.size());
+	put32(0);
+
+	//index: name "s<k>" and offset of each record
+	ulint offset = 16 + seqs.size()*(1+2+(version==1 ? 8 : 4));
+
+	for(uint k=0;k<seqs.size();k++){
+
+		out += (char)2;
+		out += 's';
+		out += (char)('0'+k);
+
+		if(version==1){
+
+			if(big_endian){ put32(offset>>32); put32(offset); }
+			else{ put32(offset); put32(offset>>32); }
+
+		}else{
+
+			put32(offset);
+
+		}
+
+		auto n_runs = runs(seqs[k],[](char c){return toupper(c)=='N';});
+		auto mask_runs = runs(seqs[k],[](char c){return islower(c);});
+
+		offset += 16 + 8*(n_runs.size()+mask_runs.size()) + (seqs[k].length()+3)/4;
+
+	}
+
+	for(auto &seq : seqs){
+
+		auto n_runs = runs(seq,[](char c){return toupper(c)=='N';});
+		auto mask_runs = runs(seq,[](char c){return islower(c);});
+
+		put32(seq.length());
+
+		for(auto r : {n_runs,mask_runs}){
+
+			put32(r.size());
+
+			for(auto x : r) put32(x.first);
+			for(auto x : r) put32(x.second);
+
+		}
+
+		put32(0);
+
+		//T=0, C=1, A=2, G=3 (N stored as T)
+		string packed((seq.length()+3)/4,0);
+
+		for(ulint i=0;i<seq.length();i++){
+
+			uchar code = string("TCAG").find(toupper(seq[i]));
+			if(code>3) code=0;
+
+			packed[i/4] |= code << (6-2*(i%4));
+
+		}
+
+		out += packed;
+
+	}
+
+	return out;
+
+}
+
+//writes small FASTA, FASTQ and 2-bit files and reads them back with SequenceFileReader and BackwardSequenceIterator
+void test_sequence_file(){
+
+	cout << "Checking SequenceFile ... " << flush;
+
+	string seq1 = "ACGTNNNNacgtnnACGTACGGTTAACCGGTTTaaaacccGGGT";
+	string seq2 = "TTTTGGGGCCCCAAAANNNN";
+	string seq3 = "GATTACA";
+
+	//text of the files: concatenation of the sequences
+	string expected = seq1+seq2+seq3;
+
+	vector<pair<string,string> > files;//file content, extension
+
+	//FASTA with fixed line width (read from disk): last line of each record shorter, last line of the file unterminated
+	auto fasta = [&](ulint width, string newline, bool terminated){
+
+		string f;
+
+		for(auto s : {seq1,seq2,seq3}){
+
+			f += ">record" + newline;
+
+			for(ulint i=0;i<s.length();i+=width)
+				f += s.substr(i,width) + newline;
+
+		}
+
+		if(not terminated)
+			f = f.substr(0,f.length()-newline.length());
+
+		return f;
+
+	};
+
+	files.push_back({fasta(10,"\n",true),".fa"});
+	files.push_back({fasta(7,"\n",false),".fa"});//all lines full: last line unterminated
+	files.push_back({fasta(10,"\r\n",true),".fasta"});
+	files.push_back({fasta(10,"\r\n",false),".fasta"});
+	files.push_back({fasta(100,"\n",true),".fna"});//one line per record
+
+	//irregular lines: packed in RAM
+	files.push_back({">a\n" + seq1.substr(0,5) + "\n" + seq1.substr(5) + "\n>b\n" + seq2 + "\n>c\n" + seq3.substr(0,4) + "\n" + seq3.substr(4) + "\n",".fa"});
+
+	//FASTQ
+	string fastq;
+	for(auto s : {seq1,seq2,seq3})
+		fastq += "@read\n" + s + "\n+\n" + string(s.length(),'I') + "\n";
+
+	files.push_back({fastq,".fq"});
+
+	//2-bit files: both endiannesses, 32-bit and 64-bit offsets
+	for(bool big_endian : {false,true})
+		for(uint version : {0,1})
+			files.push_back({two_bit_file({seq1,seq2,seq3},big_endian,version),".2bit"});
+
+	//characters other than ACGTN become N, with the same case, both on disk and when packed in RAM
+	string iupac_expected = "ACNTnCGT";
+	files.push_back({">x\nACRT\nyCGT\n",".fa"});
+	files.push_back({">x\nACRT\nyCG\nT\n",".fa"});
+
+	for(ulint k=0;k<files.size();k++){
+
+		string path = "test_sequence_file" + files[k].second;
+		string exp = k+2<files.size() ? expected : iupac_expected;
+
+		{
+			std::ofstream out(path, std::ofstream::binary);
+			out << files[k].first;
+			out.close();
+		}
+
+		SequenceFileReader sfr(path);
+		string forward = sfr.toString();
+
+		//random access by blocks of different lengths
+		string blocks(sfr.size(),0);
+		sfr.rewind();
+
+		for(ulint i=0,len=1;i<blocks.length();i+=len,len++){
+
+			len = std::min(len,blocks.length()-i);
+			sfr.read((uchar*)&blocks[i],len);
+
+		}
+
+		sfr.close();
+
+		BackwardSequenceIterator bsi(path);
+		string backward;
+
+		while(not bsi.begin())
+			backward += bsi.read();
+
+		bsi.close();
+
+		std::reverse(backward.begin(),backward.end());
+
+		remove(path.c_str());
+
+		if(forward!=exp or blocks!=exp or backward!=exp){
+
+			cout << "ERROR in file " << k << " (" << files[k].second << "): read \n" << forward << "\n" << blocks << "\n" << backward
+				 << "\ninstead of\n" << exp << endl;
+			exit(1);
+
+		}
+
+	}
+
+	cout << "ok." << endl;
+
+}
+
+//random dynamic string of length n (skewed frequencies: Huffman codes of different lengths)
+template<class bitvector_type>
+DynamicString<bitvector_type> random_dynamic_string(ulint n){
+
+	symbol sigma = 2+rand()%30;
+
+	vector<ulint> freq(sigma);
+	for(symbol c=0;c<sigma;c++)
+		freq[c] = n/(c+1);
+
+	DynamicString<bitvector_type> ds(freq);
+	vector<ulint> inserted(sigma,0);
+
+	for(ulint size=0;size<n;){
+
+		symbol c = rand()%sigma;
+
+		if(inserted[c]==freq[c])
+			continue;
+
+		ds.insert(c,rand()%(size+1));
+		inserted[c]++;
+		size++;
+
+	}
+
+	return ds;
+
+}
+
+//compares inverse_select(i) with <access(i), rank(access(i),i)>
+template<class bitvector_type>
+void check_inverse_select(DynamicString<bitvector_type> &ds){
+
+	for(ulint i=0;i<ds.size();i++){
+
+		symbol c = ds.access(i);
+		auto sr = ds.inverse_select(i);
+
+		if(sr.first!=c or sr.second!=ds.rank(c,i)){
+			cout << "ERROR: inverse_select(" << i << ") = <" << (uint)sr.first << "," << sr.second << "> instead of <"
+				 << (uint)c << "," << ds.rank(c,i) << ">" << endl;
+			exit(1);
+		}
+
+	}
+
+}
+
+void test_inverse_select(){
+
+	srand(time(NULL));
+
+	cout << "Checking DynamicString::inverse_select ... " << flush;
+
+	for(uint trial=0;trial<5;trial++){
+
+		//bitvector without access_rank: access and rank at each level
+		auto ds = random_dynamic_string<bitv>(20000);
+		check_inverse_select(ds);
+
+		//bitvector with access_rank, after random removals
+		auto pds = random_dynamic_string<packed_dynamic_bitvector_t>(20000);
+
+		for(ulint k=0;k<10000;k++)
+			pds.remove(rand()%pds.size());
+
+		check_inverse_select(pds);
+
+	}
+
+	//access_rank of the bitvector
+	packed_dynamic_bitvector<256,4> b(100000);
+
+	for(ulint k=0;k<100000;k++)
+		b.insert(rand()%(k+1),rand()%2);
+
+	for(ulint i=0;i<b.size();i++){
+
+		auto br = b.access_rank(i);
+
+		if(br.first!=b.access(i) or br.second!=b.rank(i,br.first)){
+			cout << "ERROR in access_rank(" << i << ")" << endl;
+			exit(1);
+		}
+
+	}
+
+	cout << "ok." << endl;
+
+}
+
 char remap(symbol s){
 
 	switch(s){
@@ -217,6 +1013,15 @@ char remap(symbol s){
 
  int main(int argc,char** argv) {
 
+	 test_packed_dynamic_vector();
+	 test_inverse_select();
+	 test_remove_last();
+	 test_windowed_lz77();
+	 test_dynamic_bwt_save_load();
+	 test_lz77_save_resume();
+	 test_bidirectional_fm_index();
+	 test_sequence_file();
+
 	 {
 		vector<uchar> a(50000000);
 	 }